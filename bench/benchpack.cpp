@@ -0,0 +1,177 @@
+#include <bMotion.h>
+#include <Abstract.h>
+#include <AbstractPack.h>
+#include <Settings.h>
+#include <Output.h>
+#include <Timer.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+/*
+ * loading every abstract of a language from the text files against loading
+ * them from a pack. each load is done in a process of its own, since System
+ * only looks for the pack once and keeps what it found.
+ */
+
+// abstracts made, and values in each
+#define ABSTRACTS (200)
+#define VALUES (250)
+// times each way of loading is tried, the quickest is shown
+#define TRIES (3)
+// where the abstracts are made, and taken out again afterwards
+#define DIRECTORY "benchpack.tmp"
+
+/*
+ * get the time
+ * @return milliseconds
+ */
+static double now()
+{
+	return (double)Timer::now() / 1000000;
+}
+
+/*
+ * output function that drops everything, so the log isn't timed as well
+ */
+static void quiet(int, const char*, const char*)
+{
+}
+
+/*
+ * get the name of an abstract's text file
+ * @param buffer where to put it
+ * @param i which abstract
+ * @return the buffer
+ */
+static const char* textFile(char* buffer, int i)
+{
+	sprintf(buffer, DIRECTORY "/en/bench%03d.txt", i);
+	return buffer;
+}
+
+/*
+ * write the abstracts
+ * @return true or false
+ */
+static bool make()
+{
+	mkdir(DIRECTORY, 0755);
+	mkdir(DIRECTORY "/en", 0755);
+	for (int i = 0; i < ABSTRACTS; i++)
+	{
+		char filename[64];
+		FILE* fp = fopen(textFile(filename, i), "wb");
+		if (!fp)
+			return false;
+		for (int j = 0; j < VALUES; j++)
+			fprintf(fp, "abstract %d value %d\n", i, j);
+		fclose(fp);
+	}
+	FILE* fp = fopen(DIRECTORY "/bench.conf", "wb");
+	if (!fp)
+		return false;
+	fprintf(fp, "abstracts = %s\n", DIRECTORY);
+	fclose(fp);
+	return true;
+}
+
+/*
+ * take the abstracts out again
+ */
+static void tidy()
+{
+	for (int i = 0; i < ABSTRACTS; i++)
+	{
+		char filename[64];
+		remove(textFile(filename, i));
+	}
+	remove(DIRECTORY "/en.pack");
+	remove(DIRECTORY "/bench.conf");
+	rmdir(DIRECTORY "/en");
+	rmdir(DIRECTORY);
+}
+
+/*
+ * load every abstract in a process of its own
+ * @return milliseconds it took, less than 0 if it failed
+ */
+static double load()
+{
+	int pipes[2];
+	if (pipe(pipes) != 0)
+		return -1;
+	fflush(stdout);
+	pid_t child = fork();
+	if (child == 0)
+	{
+		bMotionSetOutput(quiet);
+		double taken = -1;
+		if (bMotionSettings().parseConfigFile(DIRECTORY "/bench.conf"))
+		{
+			double began = now();
+			bool loaded = true;
+			for (int i = 0; i < ABSTRACTS; i++)
+			{
+				char name[32];
+				sprintf(name, "bench%03d", i);
+				Abstract abstract(name);
+				String value;
+				loaded = abstract.getRandomValue(value) &&
+					value.length() > 0 && loaded;
+			}
+			if (loaded)
+				taken = now() - began;
+		}
+		write(pipes[1], &taken, sizeof(taken));
+		_exit(0);
+	}
+	close(pipes[1]);
+	double taken = -1;
+	if (read(pipes[0], &taken, sizeof(taken)) != sizeof(taken))
+		taken = -1;
+	close(pipes[0]);
+	waitpid(child, NULL, 0);
+	return taken;
+}
+
+/*
+ * load the abstracts a few times and show the quickest
+ * @param name what to call it
+ * @return true if they loaded
+ */
+static bool bench(const char* name)
+{
+	double best = -1;
+	for (int i = 0; i < TRIES; i++)
+	{
+		double taken = load();
+		if (taken < 0)
+		{
+			printf("%s: failed\n", name);
+			return false;
+		}
+		if (best < 0 || taken < best)
+			best = taken;
+	}
+	printf("%s: %d abstracts of %d values in %.2f ms (%.1f us each)\n",
+			name, ABSTRACTS, VALUES, best, best * 1000 / ABSTRACTS);
+	return true;
+}
+
+int main(int, char**)
+{
+	bool ok = make() && bench("text");
+	if (ok)
+	{
+		double began = now();
+		ok = AbstractPack::build(DIRECTORY "/en", DIRECTORY "/en.pack");
+		printf("pack built in %.2f ms\n", now() - began);
+		ok = ok && bench("pack");
+	}
+	tidy();
+	return ok ? 0 : 1;
+}
+
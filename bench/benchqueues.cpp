@@ -0,0 +1,95 @@
+#include <TimerHeap.h>
+#include <TimerWheel.h>
+#include <Timer.h>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * the two timer queues side by side with 100k and 1M timers due at random
+ * over the next ten minutes: pushing them all, cancelling every tenth and
+ * firing the rest. the clock is moved on by hand as far as getWait() says,
+ * the way the timer thread would sleep.
+ */
+
+// timers are due up to this far ahead, in milliseconds
+#define SPREAD (600000)
+
+static void fire(void*)
+{
+}
+
+/*
+ * get the time
+ * @return milliseconds
+ */
+static double now()
+{
+	return (double)Timer::now() / 1000000;
+}
+
+/*
+ * push, cancel and fire timers on a queue
+ * @param queue the queue
+ * @param name what to call it
+ * @param count how many timers
+ */
+static void run(TimerQueue& queue, const char* name, int count)
+{
+	srand(7);
+	std::vector< Timer* > timers(count);
+	TimerTime clock = Timer::now();
+	for (int i = 0; i < count; i++)
+	{
+		// rand() may only go up to 32767
+		unsigned long milli = ((unsigned long)rand() * 32768 + rand()) %
+			SPREAD;
+		timers[i] = new Timer(NULL, milli, fire, NULL);
+	}
+
+	double begin = now();
+	for (int i = 0; i < count; i++)
+		queue.push(timers[i]);
+	double pushed = now() - begin;
+
+	begin = now();
+	int cancelled = 0;
+	for (int i = 0; i < count; i += 10, cancelled++)
+		queue.remove(timers[i]);
+	double removed = now() - begin;
+
+	begin = now();
+	int fired = 0;
+	unsigned long wait;
+	while (queue.getWait(clock, wait))
+	{
+		clock += wait * 1000000ULL;
+		while (queue.popDue(clock))
+			fired++;
+		if (wait == 0)
+			clock += 1000000;
+	}
+	double popped = now() - begin;
+
+	printf("%s %7d timers: push %6.1f ms (%3.0f ns each), cancel %6d "
+			"%5.1f ms (%3.0f ns each), fire %7d %6.1f ms (%3.0f ns "
+			"each)\n", name, count, pushed, pushed * 1e6 / count,
+			cancelled, removed, removed * 1e6 / cancelled, fired,
+			popped, popped * 1e6 / fired);
+	for (int i = 0; i < count; i++)
+		delete timers[i];
+}
+
+int main(int, char**)
+{
+	int counts[] = { 100000, 1000000 };
+	for (int i = 0; i < 2; i++)
+	{
+		TimerHeap heap;
+		run(heap, "heap ", counts[i]);
+		TimerWheel wheel;
+		run(wheel, "wheel", counts[i]);
+	}
+	return 0;
+}
+
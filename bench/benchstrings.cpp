@@ -0,0 +1,273 @@
+#include <bString.h>
+#include <StringBuilder.h>
+#include <Timer.h>
+#include <vector>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * String on the kind of work done for each line heard: copying the nick,
+ * channel and text, splitting the text into words and putting a reply
+ * together. counts the allocations per line as well as the time, every
+ * new in the process goes through the operators below.
+ */
+
+// lines put through each test
+#define LINES (100000)
+
+// the operators are declared differently before C++11
+#if __cplusplus >= 201103L
+#define NEW_THROWS
+#define DELETE_THROWS noexcept
+#else
+#define NEW_THROWS throw(std::bad_alloc)
+#define DELETE_THROWS throw()
+#endif
+
+static bool counting = false;
+static long allocations = 0;
+
+void* operator new(size_t size) NEW_THROWS
+{
+	if (counting)
+		allocations++;
+	void* p = malloc(size ? size : 1);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size) NEW_THROWS
+{
+	return operator new(size);
+}
+
+void operator delete(void* p) DELETE_THROWS
+{
+	free(p);
+}
+
+void operator delete[](void* p) DELETE_THROWS
+{
+	free(p);
+}
+
+#ifdef __cpp_sized_deallocation
+void operator delete(void* p, size_t) DELETE_THROWS
+{
+	free(p);
+}
+
+void operator delete[](void* p, size_t) DELETE_THROWS
+{
+	free(p);
+}
+#endif
+
+/*
+ * get the time
+ * @return milliseconds
+ */
+static double now()
+{
+	return (double)Timer::now() / 1000000;
+}
+
+/*
+ * start timing and counting allocations
+ * @return the time
+ */
+static double begin()
+{
+	allocations = 0;
+	counting = true;
+	return now();
+}
+
+/*
+ * stop timing and counting, and print the results
+ * @param name what was timed
+ * @param began what begin() returned
+ * @param count how many were done
+ */
+static void end(const char* name, double began, int count)
+{
+	double taken = now() - began;
+	counting = false;
+	printf("%-28s %7.1f ms (%5.0f ns each), %5.2f allocations each\n",
+			name, taken, taken * 1e6 / count,
+			(double)allocations / count);
+}
+
+/*
+ * what happens to a line on the way in
+ * @param nick who said it
+ * @param channel where
+ * @param text what
+ * @return how long the reply was, so none of it is optimised away
+ */
+static int processLine(const char* nick, const char* channel,
+		const char* text)
+{
+	String from(nick);
+	String to(channel);
+	String line(text);
+	std::vector< String > words;
+	int start = 0;
+	while (start < line.length())
+	{
+		int space = line.indexOf(' ', start);
+		if (space < 0)
+			space = line.length();
+		if (space > start)
+			words.push_back(line.substring(start, space));
+		start = space + 1;
+	}
+	for (unsigned int i = 0; i < words.size(); i++)
+		words[i].toLowerCase();
+
+	StringBuilder reply;
+	reply.append(from).append(": ");
+	for (int i = words.size() - 1; i >= 0; i--)
+		reply.append(words[i]).append(' ');
+	reply.append("in ").append(to);
+	String result;
+	reply.moveTo(result);
+	return result.length();
+}
+
+/*
+ * lines of short words against the same number of words too long to be
+ * kept inside the String
+ */
+static void benchLines()
+{
+	const char* shortLine = "hey there how is it going with the new box";
+	const char* longLine = "heyheyheyheyheyhey therethereTHERE "
+		"howhowhowhowhowhowhow isisisisisisisisis itititititititititit "
+		"goinggoinggoinggoing withwithwithwithwith thethethethethethe "
+		"newnewnewnewnewnewnew boxboxboxboxboxboxbox";
+	int total = 0;
+	double began = begin();
+	for (int i = 0; i < LINES; i++)
+		total += processLine("jo", "#chat", shortLine);
+	end("line, short words", began, LINES);
+	began = begin();
+	for (int i = 0; i < LINES; i++)
+		total += processLine("jo", "#chat", longLine);
+	end("line, long words", began, LINES);
+	if (total == 0)
+		printf("nothing done\n");
+}
+
+/*
+ * joining 50 words into a line with += against a StringBuilder
+ */
+static void benchConcat()
+{
+	const char* words[] = { "the ", "quick ", "brown ", "fox ", "jumps " };
+	int total = 0;
+	double began = begin();
+	for (int i = 0; i < LINES; i++)
+	{
+		String line;
+		for (int j = 0; j < 50; j++)
+			line += words[j % 5];
+		total += line.length();
+	}
+	end("50 words with +=", began, LINES);
+	began = begin();
+	StringBuilder builder;
+	for (int i = 0; i < LINES; i++)
+	{
+		builder.clear();
+		for (int j = 0; j < 50; j++)
+			builder.append(words[j % 5]);
+		String line;
+		builder.moveTo(line);
+		total += line.length();
+	}
+	end("50 words with StringBuilder", began, LINES);
+	if (total == 0)
+		printf("nothing done\n");
+}
+
+/*
+ * replaceAll on lines of growing length with a match every ten characters.
+ * the time per match and the allocations should stay flat as they grow
+ */
+static void benchReplace()
+{
+	for (int length = 1000; length <= 64000; length *= 4)
+	{
+		StringBuilder builder;
+		for (int i = 0; i < length / 10; i++)
+			builder.append("lol haha! ");
+		String text = builder.toString();
+		int runs = 1000000 / length;
+		int total = 0;
+		char name[40];
+		sprintf(name, "replaceAll, %d chars", length);
+		double began = begin();
+		for (int i = 0; i < runs; i++)
+		{
+			String line(text);
+			line.replaceAll("haha", "hehe");
+			total += line.length();
+		}
+		end(name, began, runs);
+		if (total == 0)
+			printf("nothing done\n");
+	}
+}
+
+/*
+ * the lookups on a 4k line, each looking for something at the far end of it
+ * from where it starts. none of them should allocate
+ */
+static void benchSearch()
+{
+	StringBuilder builder;
+	builder.append("@start ");
+	for (int i = 0; i < 400; i++)
+		builder.append("some text ");
+	builder.append("#end");
+	String line = builder.toString();
+	String suffix("#end");
+	int runs = LINES / 10;
+	int total = 0;
+
+	double began = begin();
+	for (int i = 0; i < runs; i++)
+		total += line.indexOf('#');
+	end("indexOf(char), 4k", began, runs);
+	began = begin();
+	for (int i = 0; i < runs; i++)
+		total += line.indexOf("#end", 0);
+	end("indexOf(const char*), 4k", began, runs);
+	began = begin();
+	for (int i = 0; i < runs; i++)
+		total += line.lastIndexOf('@');
+	end("lastIndexOf(char), 4k", began, runs);
+	began = begin();
+	for (int i = 0; i < runs; i++)
+		total += line.lastIndexOf("@start");
+	end("lastIndexOf(const char*), 4k", began, runs);
+	began = begin();
+	for (int i = 0; i < runs; i++)
+		total += line.endsWith(suffix);
+	end("endsWith, 4k", began, runs);
+	if (total == 0)
+		printf("nothing done\n");
+}
+
+int main(int, char**)
+{
+	benchLines();
+	benchConcat();
+	benchReplace();
+	benchSearch();
+	return 0;
+}
+
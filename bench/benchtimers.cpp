@@ -0,0 +1,91 @@
+#include <bMotion.h>
+#include <System.h>
+#include <Timer.h>
+#include <Thread.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+/*
+ * 100k timers pending at once through System: how long they take to add,
+ * how much CPU firing them all takes, and how much the timer thread uses
+ * while it has nothing to do but wait.
+ */
+
+#define TIMERS (100000)
+// the timers are due over this many milliseconds, starting this far ahead
+#define SPREAD (1000)
+#define START (500)
+
+static Mutex firedMutex;
+static int fired = 0;
+
+static void fire(void*)
+{
+	firedMutex.lock();
+	fired++;
+	firedMutex.unlock();
+}
+
+/*
+ * get the CPU time used by the process
+ * @return milliseconds
+ */
+static double cpu()
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_utime.tv_sec * 1e3 + usage.ru_utime.tv_usec / 1e3 +
+		usage.ru_stime.tv_sec * 1e3 + usage.ru_stime.tv_usec / 1e3;
+}
+
+/*
+ * get the time
+ * @return milliseconds, on the clock timers use
+ */
+static double now()
+{
+	return (double)Timer::now() / 1000000;
+}
+
+int main(int, char**)
+{
+	System& system = bMotionSystem();
+	// starts the timer thread, so it isn't counted below
+	system.addTimer(3600000, fire, NULL);
+
+	double begin = now();
+	// when the last of them is due
+	double due = 0;
+	for (int i = 0; i < TIMERS; i++)
+	{
+		unsigned long milli = START + (i * 7919UL) % SPREAD;
+		system.addTimer(milli, fire, NULL);
+		if (milli == START + SPREAD - 1)
+			due = now() + milli;
+	}
+	double added = now() - begin;
+	printf("added %d timers in %.1f ms (%.0f ns each)\n", TIMERS, added,
+			added * 1e6 / TIMERS);
+
+	double cpuBegin = cpu();
+	int done = 0;
+	while (done < TIMERS && now() - begin < START + SPREAD + 5000)
+	{
+		usleep(1000);
+		firedMutex.lock();
+		done = fired;
+		firedMutex.unlock();
+	}
+	printf("fired %d, the last %.1f ms after it was due, %.1f ms of CPU\n",
+			done, now() - due, cpu() - cpuBegin);
+
+	// only the hour long timer left
+	cpuBegin = cpu();
+	sleep(2);
+	printf("idle for 2 s: %.2f ms of CPU\n", cpu() - cpuBegin);
+	system.killTimers();
+	return done == TIMERS ? 0 : 1;
+}
+
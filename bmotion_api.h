@@ -48,10 +48,12 @@ typedef bool (*RegisterAdminFunc)(const char*, const char*, const char*, const c
 typedef bool (*RegisterOutputFunc)(const char*, const char*, const char*, int, const char*);
 typedef bool (*DoActionFunc)(const char*, const char*, const char*, const char* = NULL, bool = false);
 typedef void (*LogFunc)(int, const char*,...);
-typedef bool (*AddTimerFunc)(unsigned long, void(*)(void*), void*);
+typedef unsigned long (*AddTimerFunc)(unsigned long, void(*)(void*), void*);
+typedef bool (*CancelTimerFunc)(unsigned long);
 typedef bool (*UseLanguageFunc)(const char*);
 typedef bool (*AbstractRegisterFunc)(const char*);
 typedef bool (*AbstractBatchAddFunc)(const char*, ... );
+typedef bool (*AbstractAddManyFunc)(const char*, const char**, size_t);
 typedef bool (*MoodIncreaseFunc)(const char*, int = 1);
 typedef bool (*MoodDecreaseFunc)(const char*, int = 1);
 typedef bool (*MoodCreateFunc)(const char*, int, int = -30, int = 30);
@@ -75,11 +77,14 @@ typedef struct {
 	LogFunc Log;
 	// Timer support
 	AddTimerFunc AddTimer;
+	AddTimerFunc AddRepeatTimer;
+	CancelTimerFunc CancelTimer;
 	// Language support
 	UseLanguageFunc UseLanguage;
 	// Abstract support
 	AbstractRegisterFunc AbstractRegister;
 	AbstractBatchAddFunc AbstractBatchAdd;
+	AbstractAddManyFunc AbstractAddMany;
 	// mood support
 	MoodIncreaseFunc MoodIncrease;
 	MoodDecreaseFunc MoodDecrease;
@@ -105,9 +110,12 @@ static bMotionAPI bMotion = {
 	(DoActionFunc)dlsymbol("bMotionDoAction"),
 	(LogFunc)dlsymbol("bMotionLog"),
 	(AddTimerFunc)dlsymbol("bMotionAddTimer"),
+	(AddTimerFunc)dlsymbol("bMotionAddRepeatTimer"),
+	(CancelTimerFunc)dlsymbol("bMotionCancelTimer"),
 	(UseLanguageFunc)dlsymbol("bMotionUseLanguage"),
 	(AbstractRegisterFunc)dlsymbol("bMotionAbstractRegister"),
 	(AbstractBatchAddFunc)dlsymbol("bMotionAbstractBatchAdd"),
+	(AbstractAddManyFunc)dlsymbol("bMotionAbstractAddMany"),
 	(MoodIncreaseFunc)dlsymbol("bMotionMoodIncrease"),
 	(MoodDecreaseFunc)dlsymbol("bMotionMoodDecrease"),
 	(MoodCreateFunc)dlsymbol("bMotionMoodCreate"),
@@ -158,7 +166,11 @@ bool bMotionSetOutput(void(*func)(const char*));
 void bMotionLog(int level, const char* fmt, ...);
 
 // timers
-bool bMotionAddTimer(unsigned long milli, void(*callback)(void*), void* param);
+unsigned long bMotionAddTimer(unsigned long milli, void(*callback)(void*),
+		void* param);
+unsigned long bMotionAddRepeatTimer(unsigned long milli,
+		void(*callback)(void*), void* param);
+bool bMotionCancelTimer(unsigned long handle);
 
 // utility
 bool bMotionUseLanguage(const char* language);
@@ -167,6 +179,7 @@ void bMotionStatus();
 // abstracts
 bool bMotionAbstractRegister(const char* type);
 bool bMotionAbstractBatchAdd(const char* type, ... );
+bool bMotionAbstractAddMany(const char* type, const char** values, size_t n);
 
 // mood
 bool bMotionMoodIncrease(const char* name, int amount = 1);
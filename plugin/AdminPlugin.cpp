@@ -40,18 +40,24 @@ AdminPlugin::~AdminPlugin()
  * 	   there is no callback, or it's not enabled), or if the callback
  * 	   returns false which will be viewed as a failed run.
  */
-bool AdminPlugin::execute(const String& nick, const String& host,
-			const String& handle, const String& channel,
-			const String& text)
+bool AdminPlugin::execute(const StringRef& nick, const StringRef& host,
+			const StringRef& handle, const StringRef& channel,
+			const StringRef& text)
 {
 	if (!_callback || !_enabled)
 		return false;
 	bool success = false;
+	// only views that don't end in a NULL get copied
+	String copies[5];
 	Library* oldLib = bMotionSystem().getActiveLibrary();
 	if (bMotionSystem().startDangerousCode() == 0)
 	{
 		bMotionSystem().setActiveLibrary(_source);
-		success = _callback(nick, host, handle, channel, text);
+		success = _callback(nick.toCString(copies[0]),
+				host.toCString(copies[1]),
+				handle.toCString(copies[2]),
+				channel.toCString(copies[3]),
+				text.toCString(copies[4]));
 	}
 	bMotionSystem().setActiveLibrary(oldLib);
 	if (bMotionSystem().endDangerousCode())
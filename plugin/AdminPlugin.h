@@ -19,9 +19,9 @@ public:
 	virtual ~AdminPlugin();
 
 	// simple plugin specific execution
-	virtual bool execute(const String& nick, const String& host,
-			const String& handle, const String& channel,
-			const String& text);
+	virtual bool execute(const StringRef& nick, const StringRef& host,
+			const StringRef& handle, const StringRef& channel,
+			const StringRef& text);
 	
 	// overridden from class Plugin
 	virtual bool refreshCallback();
@@ -9,6 +9,8 @@ typedef bool(*EventPluginFunc)(const char*, const char*, const char*,
 
 // Event types
 enum EventType { Unknown = 0, Join, Nick, Quit, Part, Split };
+// number of event types, including Unknown
+#define EVENTTYPE_COUNT (Split + 1)
 
 /*
  * EventPlugin class. Child of Plugin.
@@ -22,9 +24,9 @@ public:
 	virtual ~EventPlugin();
 
 	// event plugin specific execution
-	virtual bool execute(const String& nick, const String& host, 
-			const String& handle, const String& channel,
-			const String& text);
+	virtual bool execute(const StringRef& nick, const StringRef& host,
+			const StringRef& handle, const StringRef& channel,
+			const StringRef& text);
 
 	// overridden from class Plugin
 	virtual bool refreshCallback();
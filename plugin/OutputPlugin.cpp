@@ -43,19 +43,23 @@ OutputPlugin::~OutputPlugin()
  * 	   there is no callback, or it's not enabled), or if the callback
  * 	   returns false which will be viewed as a failed run.
  */
-bool OutputPlugin::execute(const String& nick, const String& channel, 
-		String& text, const String& moreText)
+bool OutputPlugin::execute(const StringRef& nick, const StringRef& channel, 
+		String& text, const StringRef& moreText)
 {
 	if (!_callback || !_enabled)
 		return false;
 	bool success = false;
+	// only views that don't end in a NULL get copied
+	String copies[3];
 	Library* oldLib = bMotionSystem().getActiveLibrary();
 	if (bMotionSystem().startDangerousCode() == 0)
 	{
 		bMotionSystem().setActiveLibrary(_source);
 		char newtext[512];
 		sprintf(newtext, "%s", (const char*)text);
-		success = _callback(nick, channel, newtext, moreText);
+		success = _callback(nick.toCString(copies[0]),
+				channel.toCString(copies[1]), newtext,
+				moreText.toCString(copies[2]));
 		if (success)
 			text = newtext;
 	}
@@ -18,8 +18,8 @@ public:
 			int chance, Language lang);
 	virtual ~OutputPlugin();
 
-	virtual bool execute(const String& nick, const String& channel,
-			String& text, const String& moreText);
+	virtual bool execute(const StringRef& nick, const StringRef& channel,
+			String& text, const StringRef& moreText);
 
 	// overridden from class Plugin
 	virtual bool refreshCallback();
@@ -47,6 +47,15 @@ Plugin::~Plugin()
  * @return the given name of the plugin
  */
 const String& Plugin::getName() const
+{
+	return _name.getName();
+}
+
+/*
+ * Get the interned name of the plugin, for quick comparisons
+ * @return the name symbol
+ */
+const Symbol& Plugin::getSymbol() const
 {
 	return _name;
 }
@@ -96,6 +105,33 @@ bool Plugin::isEnabled() const
 	return _enabled;
 }
 
+/*
+ * compile the plugin regular expression. this is done once when the plugin
+ * is registered so that matching doesn't need to recompile it every time.
+ * @return true if the regular expression is valid, false otherwise.
+ */
+bool Plugin::compileRegexp()
+{
+	if (_matcher.compile(_regexp))
+		return true;
+	bMotionLog(1, "plugin \"%s\" has a bad regular expression \"%s\": %s",
+			(const char*)_name, (const char*)_regexp,
+			(const char*)_matcher.getError());
+	return false;
+}
+
+/*
+ * check the plugin regular expression against some text
+ * @param text the text to test
+ * @return true if the text matches, false if not or if the regular
+ * 	   expression has not been compiled.
+ */
+bool Plugin::matches(const StringRef& text) const
+{
+	String copy;
+	return _matcher.matches(text.toCString(copy));
+}
+
 /*
  * enable this plugin
  * @return true or false if enabling this plugin succeeded or not.
@@ -114,6 +150,7 @@ bool Plugin::enable()
 			return false;
 	}
 	_enabled = true;
+	bMotionSystem().pluginStateChanged(this);
 	bMotionLog(2, "plugin \"%s\" enabled", (const char*)_name);
 	return true;
 }
@@ -129,6 +166,7 @@ bool Plugin::disable()
 	if (_source->isLoaded())
 		bMotionSystem().disableLibrary(_source);
 	_enabled = false;
+	bMotionSystem().pluginStateChanged(this);
 	bMotionLog(2, "plugin \"%s\" disabled", (const char*)_name);
 	return true;
 }
@@ -4,9 +4,14 @@
 #include <Library.h>
 #include <bString.h>
 #include <Settings.h>
+#include <Pattern.h>
+#include <Symbol.h>
+#include <StringRef.h>
 
 // types of the plugins. all valid plugin types should be declared here.
 enum PluginType { Simple = 0, Complex, Event, Admin, Output };
+// number of plugin types
+#define PLUGINTYPE_COUNT (Output + 1)
 
 /*
  * All powerful parent class of all Plugin types.
@@ -22,12 +27,17 @@ public:
 
 	// information
 	const String& getName() const;
+	const Symbol& getSymbol() const;
 	const Library* getSource() const;
 	const String& getRegexp() const;
 	Language getLanguage() const;
 	int getChance() const;
 	bool isEnabled() const;
 
+	// matching
+	bool compileRegexp();
+	bool matches(const StringRef& text) const;
+
 	// enable / disable the plugin
 	bool enable();
 	bool disable();
@@ -44,11 +54,13 @@ protected:
 	// plugin type
 	PluginType _type;
 	// plugin name
-	String _name;
+	Symbol _name;
 	// callback function name
 	String _funcName;
 	// plugin regular expression
 	String _regexp;
+	// compiled form of _regexp
+	Pattern _matcher;
 	// plugin execution chance
 	int _chance;
 	// plugin language
@@ -23,7 +23,8 @@ extern "C" bool bMotionRegisterSimple(const char* pluginName,
 	Library* lib = bMotionSystem().getActiveLibrary();
 	SimplePlugin* plugin = new SimplePlugin(lib, pluginName, callbackName,
 			regexp, chance, language);
-	if (!plugin->enable() || !bMotionSystem().addPlugin(plugin))
+	if (!plugin->compileRegexp() || !plugin->enable() ||
+			!bMotionSystem().addPlugin(plugin))
 	{
 		delete plugin;
 		return false;
@@ -50,7 +51,8 @@ extern "C" bool bMotionRegisterComplex(const char* pluginName,
 	Library* lib = bMotionSystem().getActiveLibrary();
 	ComplexPlugin* plugin = new ComplexPlugin(lib, pluginName, callbackName,
 			regexp, chance, language);
-	if (!plugin->enable() || !bMotionSystem().addPlugin(plugin))
+	if (!plugin->compileRegexp() || !plugin->enable() ||
+			!bMotionSystem().addPlugin(plugin))
 	{
 		delete plugin;
 		return false;
@@ -78,7 +80,8 @@ extern "C" bool bMotionRegisterEvent(const char* pluginName,
 	Library* lib = bMotionSystem().getActiveLibrary();
 	EventPlugin* plugin = new EventPlugin(lib, pluginName, type, 
 			callbackName, regexp, chance, language);
-	if (!plugin->enable() || !bMotionSystem().addPlugin(plugin))
+	if (!plugin->compileRegexp() || !plugin->enable() ||
+			!bMotionSystem().addPlugin(plugin))
 	{
 		delete plugin;
 		return false;
@@ -131,7 +134,8 @@ extern "C" bool bMotionRegisterOutput(const char* pluginName,
 	Library* lib = bMotionSystem().getActiveLibrary();
 	OutputPlugin* plugin = new OutputPlugin(lib, pluginName, callbackName,
 			regexp, chance, language);
-	if (!plugin->enable() || !bMotionSystem().addPlugin(plugin))
+	if (!plugin->compileRegexp() || !plugin->enable() ||
+			!bMotionSystem().addPlugin(plugin))
 	{
 		delete plugin;
 		return false;
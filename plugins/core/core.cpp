@@ -25,7 +25,7 @@ extern "C" void Init()
 {
 	setRandomStuffTimer();
 	bMotion.AbstractRegister("randomStuff");
-	bMotion.AbstractBatchAdd("randomStuff",
+	static const char* randomStuff[] = {
 		"I'm a doctor not %VAR{sillyThings}",
 		"pika pika!" "pikachu!",
 		"pika...CHUUUU!!! *ZZZAAP*",
@@ -152,10 +152,12 @@ extern "C" void Init()
 		"this reminds me of my wedding night",
 		"my zipper's stuck %VAR{unsmiles}",
 		"is this going to be on the test?",
-		"my %VAR{bodypart} is hurting %VAR{unsmiles}",
-		ABSTRACT_END);
+		"my %VAR{bodypart} is hurting %VAR{unsmiles}"
+	};
+	bMotion.AbstractAddMany("randomStuff", randomStuff,
+		sizeof(randomStuff) / sizeof(randomStuff[0]));
 	bMotion.AbstractRegister("sillyThings");
-	bMotion.AbstractBatchAdd("sillyThings",
+	static const char* sillyThings[] = {
 		"12 year old black metal kids",
 		"14 US dollars",
 		"1.5 pie",
@@ -254,7 +256,9 @@ extern "C" void Init()
 		"a coffee pot",
 		"a company",
 		"a compiler",
-		"a complete central heating system",
-		ABSTRACT_END);
+		"a complete central heating system"
+	};
+	bMotion.AbstractAddMany("sillyThings", sillyThings,
+		sizeof(sillyThings) / sizeof(sillyThings[0]));
 }
 
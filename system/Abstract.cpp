@@ -1,35 +1,45 @@
 #include <Abstract.h>
-#include <algorithm>
 #include <bMotion.h>
 #include <File.h>
 #include <Output.h>
+#include <StringBuilder.h>
+#include <string.h>
+#include <algorithm>
 
 /*
  * Default Construction
  */
 Abstract::Abstract(const String& name)
 : _ondisk(true)
+, _indexed(false)
+, _bytes(0)
 , _language(any)
+, _sourceLanguage(bMotionSettings().language())
+, _written(false)
 {
 	if (name.length() == 0)
-		_type = "undefined";
+		_type = Symbol("undefined");
 	else
-		_type = name;
+		_type = Symbol(name);
 	char str[1024];
 #ifndef WIN32
-	sprintf(str, "%s/%s/%s.txt", 
+	sprintf(str, "%s/%s/%s.", 
 			(const char*)bMotionSettings().abstractPath(),
 			(const char*)Settings::getStringFromLanguage(
-			bMotionSettings().language()),
+			_sourceLanguage),
 	       		(const char*)_type);
 #else
-	sprintf(str, "%s\\%s\\%s.txt", 
+	sprintf(str, "%s\\%s\\%s.", 
 			(const char*)bMotionSettings().abstractPath(),
 			(const char*)Settings::getStringFromLanguage(
-			bMotionSettings().language()),
+			_sourceLanguage),
 	       		(const char*)_type);
 #endif
 	_filename = str;
+	String journal = _filename;
+	_filename.concat("txt");
+	journal.concat("journal");
+	_journal.setFiles(_filename, journal);
 }
 
 /*
@@ -37,208 +47,479 @@ Abstract::Abstract(const String& name)
  */
 Abstract::~Abstract()
 {
+	clearValues();
+}
 
+/*
+ * forget all the values held in memory and unmap the file
+ */
+void Abstract::clearValues()
+{
+	_index.clear();
+	_indexed = false;
+	_values.clear();
+	_bytes = 0;
+	int size = _added.size();
+	for (int i = 0; i < size; i++)
+		delete _added[i];
+	_added.clear();
+	_file.close();
 }
 
 /*
- * create or load the abstract from file
+ * make sure the index is there before values are added or removed. values
+ * that are in the file twice are only kept once, the file itself is tidied
+ * up the next time the journal is compacted.
+ */
+void Abstract::buildIndex()
+{
+	if (_indexed)
+		return;
+	int size = _values.size();
+	int kept = 0;
+	for (int i = 0; i < size; i++)
+	{
+		if (!_index.insert(_values[i], kept))
+			continue;
+		_values[kept++] = _values[i];
+	}
+	_values.resize(kept);
+	_indexed = true;
+}
+
+/*
+ * add a value to the ones held in memory unless it is already there
+ * @param value the value to add
+ * @return true if it was added, false if it was a duplicate
+ */
+bool Abstract::insertValue(const StringRef& value)
+{
+	buildIndex();
+	if (_index.find(value))
+		return false;
+	String* copy = new String();
+	StringBuilder builder(value.length());
+	builder.append(value.getBuffer(), value.length());
+	builder.moveTo(*copy);
+	_added.push_back(copy);
+	_bytes += value.length();
+	StringRef view(*copy);
+	_index.insert(view, _values.size());
+	_values.push_back(view);
+	return true;
+}
+
+/*
+ * pick a random index, every one equally likely. rand() may only give 15
+ * bits (RAND_MAX is 32767 on Windows) so it is called twice for big sets,
+ * and results from the incomplete last block are thrown away so that the
+ * modulo doesn't favour the low indices.
+ * @param size the number of indices, must be more than 0
+ * @return an index from 0 to size - 1
+ */
+static int randomIndex(int size)
+{
+	unsigned long range = (unsigned long)RAND_MAX + 1;
+	bool wide = (unsigned long)size > range;
+	if (wide)
+		range *= range;
+	unsigned long limit = range - range % size;
+	unsigned long r;
+	do
+	{
+		r = rand();
+		if (wide)
+			r = r * ((unsigned long)RAND_MAX + 1) + rand();
+	} while (r >= limit);
+	return r % size;
+}
+
+/*
+ * create the abstract's file if it doesn't have one. the values aren't
+ * loaded until they are needed, see load().
  * @return true or false
  */
 bool Abstract::create()
 {
-	time(&_timestamp);
+	_mutex.lock();
 	File file(_filename);
-	if (file.exists())
-		return loadType();
-	else
+	if (!file.exists())
 	{
 		file.createNewFile();	
 		file.close();
-		_values.clear();
+		clearValues();
 		_language = bMotionSettings().language();
 	}
+	_mutex.unlock();
 	return true;
 }
 
 /*
- * load abstract data out of a file
- * @param filename the filename from which to read
- * @return true or false
+ * get the abstract's name
+ * @return the name
  */
-bool Abstract::loadType()
+const Symbol& Abstract::getType() const
+{
+	return _type;
+}
+
+/*
+ * get roughly how much memory the values take up
+ * @return size in bytes, 0 if they aren't loaded
+ */
+unsigned long Abstract::getSize()
 {
+	_mutex.lock();
+	unsigned long size = 0;
 	if (!_ondisk)
-		return false;
+	{
+		size = sizeof(Abstract) + _bytes +
+			_values.capacity() * sizeof(StringRef) +
+			_added.size() * (sizeof(String*) + sizeof(String));
+		// the index is kept at most half full
+		if (_indexed)
+			size += _index.size() * 2 *
+				(sizeof(StringRef) + sizeof(int) + 1);
+	}
+	_mutex.unlock();
+	return size;
+}
 
-	File file(_filename);
-	if (!file.exists())
-		return false;
-	
-	_values.clear();
-	
-	// set timestamp to now
-	time(&_timestamp);
+/*
+ * check if the values are in memory
+ * @return true or false
+ */
+bool Abstract::isLoaded()
+{
+	_mutex.lock();
+	bool loaded = !_ondisk;
+	_mutex.unlock();
+	return loaded;
+}
 
-	if (!file.open())
-		return false;
-	bMotionLog(1, "loading abstract '%s' off disk", (const char*)_type);
-	String line;
-	std::vector< String >::iterator item;
-	bool needsReSave = false;
-	while (!file.isEOF())
-	{
-		line = file.readLine().trim();
-		if (line.length() == 0)
-			continue;
-		item = std::find(_values.begin(), _values.end(), line);
-		if (item == _values.end())
-			_values.push_back(line);
-		else
-			needsReSave = true;
-	}
-	file.close();
-	if (needsReSave)
-		storeType();
-	
-	_ondisk = false;
-	return true;
+/*
+ * load the values if they aren't in memory already, and find the other
+ * abstracts they use
+ * @param references the abstracts named by %VAR{} in the values are added
+ * 	  to this, if the values were loaded by this call
+ * @return true if the values are in memory
+ */
+bool Abstract::load(std::vector< Symbol >& references)
+{
+	_mutex.lock();
+	if (!_ondisk)
+	{
+		_mutex.unlock();
+		return true;
+	}
+	bool loaded = loadType();
+	int size = loaded ? _values.size() : 0;
+	String storage;
+	for (int i = 0; i < size; i++)
+	{
+		StringRef value = _values[i];
+		int pos = 0;
+		while ((pos = value.indexOf('%', pos)) != -1)
+		{
+			StringRef rest = value.substring(pos);
+			pos++;
+			if (!rest.startsWith("%VAR{"))
+				continue;
+			int end = rest.indexOf('}');
+			if (end == -1)
+				break;
+			Symbol name = Symbol::find(rest.substring(5, end)
+					.toCString(storage));
+			if (!name.isEmpty() && std::find(references.begin(),
+						references.end(), name) ==
+					references.end())
+				references.push_back(name);
+		}
+	}
+	_mutex.unlock();
+	return loaded;
 }
 
 /*
- * Store the abstract to disk
- * @return true or false.
+ * load abstract data out of a file. the file is mapped rather than read, and
+ * the values are views of its lines, so only the pages that values are
+ * picked from are ever read in. duplicate lines are only noticed once the
+ * abstract changes (see buildIndex()).
+ * @return true or false
  */
-bool Abstract::storeType()
+bool Abstract::loadType()
 {
-	File file(_filename);
-	if (!file.open())
+	if (!_ondisk)
 		return false;
-	if (!file.emptyFile())
+
+	File file(_filename);
+	if (!file.exists())
 		return false;
+	
+	clearValues();
+	
+	_language = bMotionSettings().language();
 
-	bool tidy = false;
-	int count = _values.size();
-	if (count > BMOTION_MAX_ABSTRACTS)
+	// the compiled pack is quicker, as long as it is up to date
+	AbstractPack* pack = bMotionSystem().getAbstractPack(_sourceLanguage);
+	int entry = pack ? pack->find(_type) : -1;
+	if (entry >= 0 && !_written && pack->isFresh(entry, _filename))
 	{
-		bMotionLog(1, "abstract %s has too many elements. tidying up",
+		bMotionLog(1, "loading abstract '%s' from pack",
 				(const char*)_type);
-		tidy = true;
+		pack->getValues(entry, _values);
+		int size = _values.size();
+		for (int i = 0; i < size; i++)
+			_bytes += _values[i].length();
 	}
-	int skipcount = 0;
-	int newcount = 0;
-	for (int i = 0; i < count; i++)
+	else
 	{
-		if (tidy && rand() % 100 < 10)
+		if (!_file.open(_filename))
 		{
-			bMotionLog(1, "Dropping %s from abstract %s", 
-					(const char*)_values[i], 
-					(const char*)_type);
-			skipcount++;
-			continue;
+			bMotionLog(1, "could not map file \"%s\"",
+					(const char*)_filename);
+			return false;
+		}
+		bMotionLog(1, "loading abstract '%s' off disk",
+				(const char*)_type);
+		const char* p = _file.getData();
+		const char* end = p + _file.size();
+		while (p < end)
+		{
+			const char* eol = (const char*)memchr(p, '\n', end - p);
+			if (!eol)
+				eol = end;
+			StringRef line = StringRef(p, eol - p).trimmed();
+			if (!line.isEmpty())
+			{
+				_values.push_back(line);
+				_bytes += line.length();
+			}
+			p = eol + 1;
 		}
-		file.writeLine(_values[i]);
-		newcount++;
 	}
-	if (tidy)
-		bMotionLog(1, "Abstract %s now has %d elements (%d fewer)",
-				newcount, skipcount);
-	file.close();
+
+	// then the changes made since the file was last written
+	int changes = _journal.replay(replayChange, this);
+	if (changes > 0)
+		bMotionLog(1, "replayed %d changes to abstract '%s'", changes,
+				(const char*)_type);
+	
+	_ondisk = false;
 	return true;
 }
 
 /*
  * add a value to the abstract
  * @param value the value to add the the abstract
- * @param save force a disk save on the abstract
+ * @param save record the change so that it is kept
  * @return true or false. 
  */
 bool Abstract::addValue(const String& value, bool save)
 {
+	_mutex.lock();
+	bool added;
 	if (_ondisk)
 	{
 		bMotionLog(1, "updating abstracts '%s' on disk", 
 				(const char*)_type);
-		if (!save)
-			return false;
-		File file(_filename);
-		if (!file.open())
-			return false;
-		file.skip(file.available());
-		file.writeLine(value);
-		file.close();
-		return true;
+		added = save;
 	}
-	std::vector< String >::iterator item;
-	item = std::find(_values.begin(), _values.end(), value);
-	if (item != _values.end())
-		return false;
-	_values.push_back(value);
-	if (save)
+	else
+		added = insertValue(value);
+	if (added && save)
 	{
-		File file(_filename);
-		if (!file.open())
-			return false;
-		file.skip(file.available());
-		file.writeLine(value);
-		file.close();
+		_journal.record(true, value);
+		_written = true;
 	}
-	return true;
+	_mutex.unlock();
+	return added;
+}
+
+/*
+ * add a batch of values to the abstract. values that are already there, or
+ * that are in the batch more than once, are only added once, and the new
+ * ones are recorded together.
+ * @param values the values to add. NULL and empty ones are skipped.
+ * @param count the number of values
+ * @param save record the changes so that they are kept
+ * @return the number of values that were new
+ */
+int Abstract::addValues(const char** values, int count, bool save)
+{
+	_mutex.lock();
+	// duplicates can only be spotted with the values in memory
+	if (_ondisk && !loadType())
+	{
+		_mutex.unlock();
+		return 0;
+	}
+	std::vector< StringRef > added;
+	added.reserve(count);
+	for (int i = 0; i < count; i++)
+	{
+		if (!values[i] || !*values[i])
+			continue;
+		if (insertValue(values[i]))
+			added.push_back(_values.back());
+	}
+	if (save && added.size() > 0)
+	{
+		_journal.record(true, added);
+		_written = true;
+	}
+	_mutex.unlock();
+	return added.size();
 }
 
 /*
  * Remove a specific value from the abstract
  * @param value the value to remove
+ * @param save record the change so that it is kept
  * @return true or false.
  */
 bool Abstract::removeValue(const String& value, bool save)
 {
-	std::vector< String >::iterator item;
-	item = std::find(_values.begin(), _values.end(), value);
-	if (item == _values.end())
+	_mutex.lock();
+	bool removed = eraseValue(value);
+	if (removed && save)
+	{
+		_journal.record(false, value);
+		_written = true;
+	}
+	_mutex.unlock();
+	return removed;
+}
+
+/*
+ * take a value out of the ones held in memory
+ * @param value the value to remove
+ * @return true if it was there
+ */
+bool Abstract::eraseValue(const StringRef& value)
+{
+	buildIndex();
+	int* found = _index.find(value);
+	if (!found)
 		return false;
-	_values.erase(item);
-	if (save)
-		return storeType();
+	// move the last value into the gap
+	int position = *found;
+	StringRef removed = _values[position];
+	_index.erase(removed);
+	int last = _values.size() - 1;
+	if (position != last)
+	{
+		_values[position] = _values[last];
+		*_index.find(_values[position]) = position;
+	}
+	_values.pop_back();
+	_bytes -= removed.length();
+	// values that were added have to be freed. there are usually only a
+	// few of them
+	int added = _added.size();
+	for (int i = 0; i < added; i++)
+	{
+		if ((const char*)*_added[i] == removed.getBuffer())
+		{
+			delete _added[i];
+			_added[i] = _added[added - 1];
+			_added.pop_back();
+			break;
+		}
+	}
 	return true;
 }
 
+/*
+ * apply a change from the journal while loading
+ * @param abstract the Abstract being loaded
+ * @param add true if the value was added, false if it was removed
+ * @param value the value
+ */
+void Abstract::replayChange(void* abstract, bool add, const StringRef& value)
+{
+	Abstract* self = (Abstract*)abstract;
+	if (add)
+		self->insertValue(value);
+	else
+		self->eraseValue(value);
+}
+
 /*
  * get a random value from an abstract
- * @return a string from the book of abstracts.
+ * @param value set to a string from the book of abstracts
+ * @param load load the values if they aren't in memory. otherwise a
+ * 	  cold abstract gives nothing.
+ * @return true or false. false if there are no values to pick from.
  */
-String Abstract::getRandomValue()
+bool Abstract::getRandomValue(String& value, bool load)
 {
-	// set timestamp to now
-	time(&_timestamp);
-	if (_ondisk)
+	_mutex.lock();
+	if (_ondisk && load)
 		loadType();
 	int size = _values.size();
 	if (size == 0)
-		return "";//_values[0];
-	int ind = rand() % size;
-	return _values[ind];
+	{
+		_mutex.unlock();
+		return false;
+	}
+	value = _values[randomIndex(size)].toString();
+	_mutex.unlock();
+	return true;
 }
 
 /*
- * Abstract garbage collection. Simple, if enough time has gone by with no
- * activity, write to disk, free the memory.
- * @return true or false
+ * free the values, they are loaded again when they are next needed. this
+ * is a good time to rewrite the file, since nothing is looking into it.
+ * @return true if they were loaded
  */
-bool Abstract::garbageCollect()
+bool Abstract::unload()
 {
-	if (_ondisk)
-		return false;
-	time_t now;
-	time(&now);
-	if (difftime(now, _timestamp) > BMOTION_MAX_ABSTRACT_AGE ||
-			_language != bMotionSettings().language())
+	_mutex.lock();
+	bool loaded = !_ondisk;
+	if (loaded)
 	{
-		bMotionLog(1, "Expiring abstract '%s'", (const char*)_type);
+		bMotionLog(1, "unloading abstract '%s'", (const char*)_type);
 		_ondisk = true;
-		_values.clear();
-		return true;
+		clearValues();
 	}
-	return false;
+	// still locked, so that a load can't map the file before it is
+	// rewritten and then replay a journal that has been emptied
+	if (loaded && !_journal.isEmpty())
+		_journal.compact();
+	_mutex.unlock();
+	return loaded;
+}
+
+/*
+ * Abstract garbage collection. Values loaded for another language are
+ * freed, which abstracts stay loaded otherwise is up to the AbstractCache.
+ * @return true or false
+ */
+bool Abstract::garbageCollect()
+{
+	_mutex.lock();
+	bool expired = !_ondisk && _language != bMotionSettings().language();
+	_mutex.unlock();
+	if (expired)
+		bMotionLog(1, "Expiring abstract '%s'", (const char*)_type);
+	return expired && unload();
+}
+
+/*
+ * write out the changes made since the last flush, folding them into the
+ * file once enough of them have built up. the abstract is locked throughout
+ * (see unload()).
+ * @return true or false
+ */
+bool Abstract::flush()
+{
+	_mutex.lock();
+	bool success = _journal.flush();
+	if (success && _journal.size() > ABSTRACTJOURNAL_COMPACT_SIZE)
+		success = _journal.compact();
+	_mutex.unlock();
+	return success;
 }
 
 /*
@@ -248,6 +529,14 @@ bool Abstract::garbageCollect()
 void bMotionAbstractGarbageCollect(void*)
 {
 	bMotionSystem().abstractGarbageCollect();
-	bMotionSystem().addTimer(300000, bMotionAbstractGarbageCollect, NULL);
+}
+
+/*
+ * Timer callback for writing out abstract changes
+ * @param ____ nothing
+ */
+void bMotionAbstractFlush(void*)
+{
+	bMotionSystem().abstractFlush();
 }
 
@@ -2,9 +2,14 @@
 #define ABSTRACT_H
 
 #include <bString.h>
-#include <time.h>
 #include <vector>
 #include <Settings.h>
+#include <Symbol.h>
+#include <HashMap.h>
+#include <StringRef.h>
+#include <MappedFile.h>
+#include <AbstractJournal.h>
+#include <Thread.h>
 
 class Abstract
 {
@@ -14,31 +19,69 @@ public:
 
 	// equivalent of register
 	bool create();
+
+	// information
+	const Symbol& getType() const;
+	unsigned long getSize();
+
+	// loading
+	bool isLoaded();
+	bool load(std::vector< Symbol >& references);
+	bool unload();
 	
 	// addition / subtraction
 	bool addValue(const String& value, bool save = true);
+	int addValues(const char** values, int count, bool save = true);
 	bool removeValue(const String& value, bool save = true);
 	
 	// get
-	String getRandomValue();
+	bool getRandomValue(String& value, bool load = true);
 
 	// cleanup
 	bool garbageCollect();
+	bool flush();
 	
 private:
-	String _type;
+	// abstracts are loaded on a thread of their own, this guards the
+	// values and everything to do with them
+	Mutex _mutex;
+	Symbol _type;
 	bool _ondisk;
 	String _filename;
-	std::vector< String > _values;
-	time_t _timestamp;
+	// the file as it was when loaded
+	MappedFile _file;
+	// every value, each a view into _file or into one of _added
+	std::vector< StringRef > _values;
+	// values added since the file was loaded
+	std::vector< String* > _added;
+	// where each value is in _values. only built once something is added
+	// or removed, picking values doesn't need it
+	HashMap< StringRef, int, hashref, eqref > _index;
+	bool _indexed;
+	// bytes of text in the values
+	unsigned long _bytes;
 	Language _language;
+	// the language whose files the abstract comes from
+	Language _sourceLanguage;
+	// changes not yet folded into the file
+	AbstractJournal _journal;
+	// changes have been recorded, so the file may have been rewritten
+	// since the pack was built. the pack only notices to the second, so it
+	// isn't trusted after that
+	bool _written;
 
 	bool loadType();
-	bool storeType();
+	void buildIndex();
+	bool insertValue(const StringRef& value);
+	bool eraseValue(const StringRef& value);
+	void clearValues();
+	static void replayChange(void* abstract, bool add,
+			const StringRef& value);
 	
 };
 
 void bMotionAbstractGarbageCollect(void*);
+void bMotionAbstractFlush(void*);
 
 #endif
 
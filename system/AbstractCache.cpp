@@ -0,0 +1,330 @@
+#include <AbstractCache.h>
+#include <Abstract.h>
+#include <string.h>
+
+/*
+ * Constructor. Nothing is loaded to begin with.
+ */
+AbstractCache::AbstractCache()
+: _head(NULL)
+, _tail(NULL)
+, _resident(0)
+, _additions(0)
+, _hits(0)
+, _misses(0)
+, _evictions(0)
+{
+	memset(_sketch, 0, sizeof(_sketch));
+}
+
+/*
+ * Destructor
+ */
+AbstractCache::~AbstractCache()
+{
+	std::map< Abstract*, Entry* >::iterator iter = _entries.begin();
+	while (iter != _entries.end())
+	{
+		delete iter->second;
+		++iter;
+	}
+}
+
+/*
+ * note that an abstract has been used
+ * @param abstract the abstract
+ * @param hit true if its values were in memory
+ */
+void AbstractCache::touch(Abstract* abstract, bool hit)
+{
+	_mutex.lock();
+	if (hit)
+		_hits++;
+	else
+		_misses++;
+	increment(abstract);
+	std::map< Abstract*, Entry* >::iterator iter = _entries.find(abstract);
+	if (iter != _entries.end())
+	{
+		unlink(iter->second);
+		pushFront(iter->second);
+	}
+	_mutex.unlock();
+}
+
+/*
+ * say how much memory an abstract takes up now, after it has been loaded,
+ * changed or unloaded
+ * @param abstract the abstract
+ * @param bytes its size, 0 if it isn't loaded
+ */
+void AbstractCache::resize(Abstract* abstract, unsigned long bytes)
+{
+	_mutex.lock();
+	Entry* entry = NULL;
+	std::map< Abstract*, Entry* >::iterator iter = _entries.find(abstract);
+	if (iter != _entries.end())
+	{
+		entry = iter->second;
+		_resident -= entry->bytes;
+	}
+	if (bytes == 0)
+	{
+		if (entry)
+		{
+			unlink(entry);
+			_entries.erase(iter);
+			delete entry;
+		}
+	}
+	else
+	{
+		if (!entry)
+		{
+			entry = new Entry;
+			entry->abstract = abstract;
+			entry->chosen = false;
+			entry->prev = NULL;
+			entry->next = NULL;
+			_entries[abstract] = entry;
+			pushFront(entry);
+		}
+		entry->bytes = bytes;
+		_resident += bytes;
+	}
+	_mutex.unlock();
+}
+
+/*
+ * decide whether an abstract that might be wanted soon is worth loading
+ * @param abstract the abstract
+ * @param budget the most bytes the loaded abstracts should take, 0 for no
+ * 	  limit
+ * @return true if there is room for it, or it is used more often than the
+ * 	   abstract that would make room for it. its size isn't known until it
+ * 	   is loaded, so it is taken to be the average.
+ */
+bool AbstractCache::admit(Abstract* abstract, unsigned long budget)
+{
+	_mutex.lock();
+	unsigned long expected = _entries.empty() ? 0 :
+		_resident / _entries.size();
+	bool admitted = budget == 0 || _resident + expected <= budget;
+	if (!admitted)
+	{
+		int victim = -1;
+		Entry* entry = _tail;
+		for (int i = 0; entry && i < ABSTRACTCACHE_SAMPLE; i++)
+		{
+			int count = frequency(entry->abstract);
+			if (victim < 0 || count < victim)
+				victim = count;
+			entry = entry->prev;
+		}
+		admitted = frequency(abstract) > victim;
+	}
+	_mutex.unlock();
+	return admitted;
+}
+
+/*
+ * pick the abstracts to unload to get back under the budget. each is the
+ * least frequently used of the least recently used few.
+ * @param budget the most bytes the loaded abstracts should take, 0 for no
+ * 	  limit
+ * @param keep an abstract that mustn't be picked, say one that has just
+ * 	  been loaded because it is needed
+ * @return the abstracts to unload, in the order to unload them
+ */
+std::vector< Abstract* > AbstractCache::getVictims(unsigned long budget,
+		Abstract* keep)
+{
+	std::vector< Abstract* > victims;
+	std::vector< Entry* > chosen;
+	_mutex.lock();
+	unsigned long resident = _resident;
+	while (budget > 0 && resident > budget)
+	{
+		Entry* victim = NULL;
+		int lowest = 0;
+		int looked = 0;
+		Entry* entry = _tail;
+		while (entry && looked < ABSTRACTCACHE_SAMPLE)
+		{
+			if (!entry->chosen && entry->abstract != keep)
+			{
+				int count = frequency(entry->abstract);
+				if (!victim || count < lowest)
+				{
+					victim = entry;
+					lowest = count;
+				}
+				looked++;
+			}
+			entry = entry->prev;
+		}
+		if (!victim)
+			break;
+		victim->chosen = true;
+		chosen.push_back(victim);
+		victims.push_back(victim->abstract);
+		resident -= victim->bytes;
+	}
+	int size = chosen.size();
+	for (int i = 0; i < size; i++)
+		chosen[i]->chosen = false;
+	_evictions += size;
+	_mutex.unlock();
+	return victims;
+}
+
+/*
+ * get the number of abstracts loaded
+ * @return abstract count
+ */
+int AbstractCache::size()
+{
+	_mutex.lock();
+	int size = _entries.size();
+	_mutex.unlock();
+	return size;
+}
+
+/*
+ * get the memory taken up by the loaded abstracts
+ * @return size in bytes
+ */
+unsigned long AbstractCache::getResident()
+{
+	_mutex.lock();
+	unsigned long resident = _resident;
+	_mutex.unlock();
+	return resident;
+}
+
+/*
+ * get the number of times an abstract was used with its values in memory
+ * @return hit count
+ */
+unsigned long AbstractCache::getHits()
+{
+	_mutex.lock();
+	unsigned long hits = _hits;
+	_mutex.unlock();
+	return hits;
+}
+
+/*
+ * get the number of times an abstract was used before it was loaded
+ * @return miss count
+ */
+unsigned long AbstractCache::getMisses()
+{
+	_mutex.lock();
+	unsigned long misses = _misses;
+	_mutex.unlock();
+	return misses;
+}
+
+/*
+ * get the number of abstracts picked to be unloaded to make room
+ * @return eviction count
+ */
+unsigned long AbstractCache::getEvictions()
+{
+	_mutex.lock();
+	unsigned long evictions = _evictions;
+	_mutex.unlock();
+	return evictions;
+}
+
+/*
+ * take an entry out of the recently used list
+ * @param entry the entry
+ */
+void AbstractCache::unlink(Entry* entry)
+{
+	if (entry->prev)
+		entry->prev->next = entry->next;
+	else
+		_head = entry->next;
+	if (entry->next)
+		entry->next->prev = entry->prev;
+	else
+		_tail = entry->prev;
+	entry->prev = NULL;
+	entry->next = NULL;
+}
+
+/*
+ * put an entry at the front of the recently used list
+ * @param entry the entry
+ */
+void AbstractCache::pushFront(Entry* entry)
+{
+	entry->prev = NULL;
+	entry->next = _head;
+	if (_head)
+		_head->prev = entry;
+	_head = entry;
+	if (!_tail)
+		_tail = entry;
+}
+
+/*
+ * find an abstract's counter in one row of the sketch
+ * @param hash the abstract's hash
+ * @param row the row, 0 to 3
+ * @return the counter's index in the row
+ */
+unsigned int AbstractCache::slot(unsigned int hash, int row)
+{
+	static const unsigned int seeds[4] =
+		{ 0x9e3779b1U, 0x85ebca77U, 0xc2b2ae3dU, 0x27d4eb2fU };
+	unsigned int h = (hash + row) * seeds[row];
+	h ^= h >> 15;
+	return h & (ABSTRACTCACHE_SKETCH_WIDTH - 1);
+}
+
+/*
+ * count a use of an abstract. the counters stop at 15, and once enough uses
+ * have been counted they are all halved.
+ * @param abstract the abstract
+ */
+void AbstractCache::increment(Abstract* abstract)
+{
+	unsigned int hash = abstract->getType().hash();
+	for (int row = 0; row < 4; row++)
+	{
+		unsigned char& counter = _sketch[row][slot(hash, row)];
+		if (counter < 15)
+			counter++;
+	}
+	if (++_additions < 10 * ABSTRACTCACHE_SKETCH_WIDTH)
+		return;
+	for (int row = 0; row < 4; row++)
+	{
+		for (int i = 0; i < ABSTRACTCACHE_SKETCH_WIDTH; i++)
+			_sketch[row][i] >>= 1;
+	}
+	_additions /= 2;
+}
+
+/*
+ * estimate how often an abstract has been used lately
+ * @param abstract the abstract
+ * @return the smallest of its counters
+ */
+int AbstractCache::frequency(Abstract* abstract) const
+{
+	unsigned int hash = abstract->getType().hash();
+	int count = 15;
+	for (int row = 0; row < 4; row++)
+	{
+		int counter = _sketch[row][slot(hash, row)];
+		if (counter < count)
+			count = counter;
+	}
+	return count;
+}
+
@@ -0,0 +1,90 @@
+#ifndef ABSTRACTCACHE_H
+#define ABSTRACTCACHE_H
+
+#include <map>
+#include <vector>
+#include <Thread.h>
+
+class Abstract;
+
+// counters in each row of the frequency sketch, a power of two
+#define ABSTRACTCACHE_SKETCH_WIDTH (512)
+// how many of the least recently used abstracts are looked at to pick one
+// to unload
+#define ABSTRACTCACHE_SAMPLE (8)
+
+/*
+ * Keeps track of how much memory the loaded abstracts take up, and decides
+ * which ones to unload when there are too many. It never loads or unloads
+ * anything itself, System does that with what it says.
+ *
+ * Every use of an abstract is counted in a small count-min sketch, whether
+ * the abstract is loaded or not, and the counts are halved every so often
+ * so that old popularity fades (TinyLFU). The loaded abstracts are also
+ * kept in least recently used order.
+ *
+ * When the loaded abstracts go over the budget, the least frequently used
+ * of the few least recently used ones is unloaded, until they fit. An
+ * abstract that is only being loaded because it might be wanted is let in
+ * if there looks to be room, or if it is used more often than the abstract
+ * it would push out; one that is needed right now always is.
+ *
+ * All of the methods are thread safe. The cache never locks an
+ * Abstract, so it can be used with an abstract's lock held.
+ */
+class AbstractCache
+{
+public:
+	AbstractCache();
+	virtual ~AbstractCache();
+
+	// use
+	void touch(Abstract* abstract, bool hit);
+	void resize(Abstract* abstract, unsigned long bytes);
+	bool admit(Abstract* abstract, unsigned long budget);
+	std::vector< Abstract* > getVictims(unsigned long budget,
+			Abstract* keep = NULL);
+
+	// statistics
+	int size();
+	unsigned long getResident();
+	unsigned long getHits();
+	unsigned long getMisses();
+	unsigned long getEvictions();
+
+private:
+	// not copyable
+	AbstractCache(const AbstractCache& other);
+	AbstractCache& operator=(const AbstractCache& other);
+
+	struct Entry
+	{
+		Abstract* abstract;
+		unsigned long bytes;
+		bool chosen;
+		Entry* prev;
+		Entry* next;
+	};
+
+	void unlink(Entry* entry);
+	void pushFront(Entry* entry);
+	void increment(Abstract* abstract);
+	int frequency(Abstract* abstract) const;
+	static unsigned int slot(unsigned int hash, int row);
+
+	std::map< Abstract*, Entry* > _entries;
+	// most recently used first
+	Entry* _head;
+	Entry* _tail;
+	unsigned long _resident;
+	unsigned char _sketch[4][ABSTRACTCACHE_SKETCH_WIDTH];
+	// uses counted since the sketch was last halved
+	int _additions;
+	unsigned long _hits;
+	unsigned long _misses;
+	unsigned long _evictions;
+	Mutex _mutex;
+};
+
+#endif
+
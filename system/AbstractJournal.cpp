@@ -0,0 +1,389 @@
+#include <AbstractJournal.h>
+#include <Output.h>
+#include <HashMap.h>
+#include <MappedFile.h>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+
+#include <fcntl.h>
+#ifndef WIN32
+#include <sys/types.h>
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+/*
+ * push a file that has been written out of the operating system's cache
+ * @param fp the open file
+ * @return true or false
+ */
+static bool syncFile(FILE* fp)
+{
+	if (fflush(fp) != 0)
+		return false;
+#ifndef WIN32
+	return fsync(fileno(fp)) == 0;
+#else
+	return _commit(_fileno(fp)) == 0;
+#endif
+}
+
+/*
+ * make a rename in the directory holding a file stick. only needed on
+ * unix, windows does it as part of the rename.
+ * @param filename the file that was renamed
+ */
+static void syncDirectory(const String& filename)
+{
+#ifndef WIN32
+	String directory(".");
+	int slash = filename.lastIndexOf('/');
+	if (slash == 0)
+		directory = "/";
+	else if (slash > 0)
+		directory = filename.substring(0, slash);
+	int fd = open((const char*)directory, O_RDONLY);
+	if (fd < 0)
+		return;
+	fsync(fd);
+	close(fd);
+#endif
+}
+
+/*
+ * Constructor. There are no files until setFiles() is called.
+ */
+AbstractJournal::AbstractJournal()
+: _size(0)
+{
+
+}
+
+/*
+ * Destructor. Anything not flushed yet is written out.
+ */
+AbstractJournal::~AbstractJournal()
+{
+	flush();
+}
+
+/*
+ * say which files the journal looks after
+ * @param base the abstract's text file
+ * @param journal the journal file that goes with it
+ */
+void AbstractJournal::setFiles(const String& base, const String& journal)
+{
+	_mutex.lock();
+	_base = base;
+	_journal = journal;
+	_pending.clear();
+	recover();
+	_mutex.unlock();
+}
+
+/*
+ * find out how big the journal file is, cutting off a last line that was
+ * only half written when the bot went down. must be called with the lock
+ * held.
+ */
+void AbstractJournal::recover()
+{
+	_size = 0;
+	MappedFile file;
+	if (!file.open(_journal))
+		return;
+	const char* data = file.getData();
+	int length = file.size();
+	int keep = length;
+	while (keep > 0 && data[keep - 1] != '\n')
+		keep--;
+	file.close();
+	if (keep < length)
+	{
+		bMotionLog(1, "dropping %d bytes of unfinished changes "
+				"from \"%s\"", length - keep,
+				(const char*)_journal);
+#ifndef WIN32
+		if (truncate((const char*)_journal, keep) != 0)
+#else
+		int fd = _open((const char*)_journal, _O_RDWR | _O_BINARY);
+		bool truncated = fd >= 0 && _chsize(fd, keep) == 0;
+		if (fd >= 0)
+			_close(fd);
+		if (!truncated)
+#endif
+		{
+			bMotionLog(1, "could not truncate \"%s\"",
+					(const char*)_journal);
+		}
+	}
+	_size = keep;
+}
+
+/*
+ * add a change to the journal. it is only kept in memory until the next
+ * flush().
+ * @param add true if the value was added, false if it was removed
+ * @param value the value
+ */
+void AbstractJournal::record(bool add, const StringRef& value)
+{
+	_mutex.lock();
+	_pending.append(add ? '+' : '-');
+	_pending.append(value.getBuffer(), value.length());
+	_pending.append('\n');
+	_mutex.unlock();
+}
+
+/*
+ * add a batch of changes to the journal, all of the same kind
+ * @param add true if the values were added, false if they were removed
+ * @param values the values
+ */
+void AbstractJournal::record(bool add, const std::vector< StringRef >& values)
+{
+	_mutex.lock();
+	int size = values.size();
+	for (int i = 0; i < size; i++)
+	{
+		_pending.append(add ? '+' : '-');
+		_pending.append(values[i].getBuffer(), values[i].length());
+		_pending.append('\n');
+	}
+	_mutex.unlock();
+}
+
+/*
+ * append the changes held in memory to the journal file and sync it. must
+ * be called with the lock held.
+ * @return true or false. the changes are kept for the next try if it fails.
+ */
+bool AbstractJournal::write()
+{
+	int length = _pending.length();
+	if (length == 0)
+		return true;
+	FILE* fp = fopen(_journal, "ab");
+	bool success = fp && fwrite(_pending.getBuffer(), 1, length, fp) ==
+		(size_t)length && syncFile(fp);
+	if (fp && fclose(fp) != 0)
+		success = false;
+	if (!success)
+	{
+		bMotionLog(1, "could not write to \"%s\"",
+				(const char*)_journal);
+		// don't leave half a change for the next lot to be stuck onto
+		recover();
+		return false;
+	}
+	_size += length;
+	_pending.clear();
+	return true;
+}
+
+/*
+ * write out all the changes recorded so far
+ * @return true or false
+ */
+bool AbstractJournal::flush()
+{
+	_mutex.lock();
+	bool success = write();
+	_mutex.unlock();
+	return success;
+}
+
+/*
+ * check if there are any changes, flushed or not
+ * @return true or false
+ */
+bool AbstractJournal::isEmpty()
+{
+	_mutex.lock();
+	bool empty = _size == 0 && _pending.length() == 0;
+	_mutex.unlock();
+	return empty;
+}
+
+/*
+ * get the size of the journal
+ * @return size in bytes, including the changes not flushed yet
+ */
+int AbstractJournal::size()
+{
+	_mutex.lock();
+	int size = _size + _pending.length();
+	_mutex.unlock();
+	return size;
+}
+
+/*
+ * read one change out of the journal
+ * @param line the line, without its end of line
+ * @param add set to true for an added value, false for a removed one
+ * @return the value, empty if the line isn't a change
+ */
+static StringRef parseChange(const StringRef& line, bool& add)
+{
+	if (line.isEmpty() || (line[0] != '+' && line[0] != '-'))
+		return StringRef();
+	add = line[0] == '+';
+	StringRef value = line.substring(1).trimmed();
+	if (value.isEmpty() || memchr(value.getBuffer(), '\0', value.length()))
+		return StringRef();
+	return value;
+}
+
+/*
+ * go through the changes in the journal in the order they were made. the
+ * values handed over look into the journal and only last for the call.
+ * @param apply called for each change with data, whether the value was
+ * 	  added and the value
+ * @param data passed to apply
+ * @return the number of changes
+ */
+int AbstractJournal::replay(void (*apply)(void*, bool, const StringRef&),
+		void* data)
+{
+	_mutex.lock();
+	write();
+	int count = 0;
+	MappedFile file;
+	if (_size > 0 && file.open(_journal))
+	{
+		const char* p = file.getData();
+		const char* end = p +
+			(_size < file.size() ? _size : file.size());
+		const char* eol;
+		while (p < end && (eol = (const char*)memchr(p, '\n', end - p)))
+		{
+			bool add = false;
+			StringRef value = parseChange(StringRef(p, eol - p),
+					add);
+			p = eol + 1;
+			if (value.isEmpty())
+				continue;
+			apply(data, add, value);
+			count++;
+		}
+	}
+	_mutex.unlock();
+	return count;
+}
+
+/*
+ * fold the journal into the text file and empty it. on windows this fails
+ * while the text file is mapped and is tried again later.
+ * @return true if the journal is empty afterwards
+ */
+bool AbstractJournal::compact()
+{
+	_mutex.lock();
+	if (!write() || _size == 0)
+	{
+		bool empty = _size == 0;
+		_mutex.unlock();
+		return empty;
+	}
+
+	// the text file the way Abstract reads it, then the changes
+	MappedFile base;
+	MappedFile journal;
+	std::vector< StringRef > values;
+	HashMap< StringRef, int, hashref, eqref > index;
+	if (base.open(_base))
+	{
+		const char* p = base.getData();
+		const char* end = p + base.size();
+		while (p < end)
+		{
+			const char* eol = (const char*)memchr(p, '\n', end - p);
+			if (!eol)
+				eol = end;
+			StringRef line = StringRef(p, eol - p).trimmed();
+			p = eol + 1;
+			if (line.isEmpty() || memchr(line.getBuffer(), '\0',
+						line.length()))
+				continue;
+			if (index.insert(line, values.size()))
+				values.push_back(line);
+		}
+	}
+	if (!journal.open(_journal))
+	{
+		_mutex.unlock();
+		return false;
+	}
+	const char* p = journal.getData();
+	const char* end = p + (_size < journal.size() ? _size : journal.size());
+	const char* eol;
+	while (p < end && (eol = (const char*)memchr(p, '\n', end - p)))
+	{
+		bool add = false;
+		StringRef value = parseChange(StringRef(p, eol - p), add);
+		p = eol + 1;
+		if (value.isEmpty())
+			continue;
+		if (add)
+		{
+			if (index.insert(value, values.size()))
+				values.push_back(value);
+			continue;
+		}
+		int* found = index.find(value);
+		if (!found)
+			continue;
+		int position = *found;
+		index.erase(value);
+		int last = values.size() - 1;
+		if (position != last)
+		{
+			values[position] = values[last];
+			*index.find(values[position]) = position;
+		}
+		values.pop_back();
+	}
+
+	// everything is kept, the file has to match what the Abstract holds
+	int count = values.size();
+	StringBuilder contents;
+	for (int i = 0; i < count; i++)
+	{
+		contents.append(values[i].getBuffer(), values[i].length());
+		contents.append('\n');
+	}
+	base.close();
+	journal.close();
+
+	String temp = _base;
+	temp.concat(".tmp");
+	FILE* out = fopen(temp, "wb");
+	bool success = out && fwrite(contents.getBuffer(), 1,
+			contents.length(), out) == (size_t)contents.length() &&
+		syncFile(out);
+	if (out && fclose(out) != 0)
+		success = false;
+#ifdef WIN32
+	if (success)
+		remove(_base);
+#endif
+	if (!success || rename(temp, _base) != 0)
+	{
+		bMotionLog(1, "could not compact \"%s\"", (const char*)_base);
+		remove(temp);
+		_mutex.unlock();
+		return false;
+	}
+	syncDirectory(_base);
+	// the text file has everything now
+	remove(_journal);
+	_size = 0;
+	_mutex.unlock();
+	bMotionLog(1, "compacted \"%s\" (%d values)", (const char*)_base,
+			count);
+	return true;
+}
+
@@ -0,0 +1,76 @@
+#ifndef ABSTRACTJOURNAL_H
+#define ABSTRACTJOURNAL_H
+
+#include <vector>
+#include <bString.h>
+#include <StringRef.h>
+#include <StringBuilder.h>
+#include <Thread.h>
+
+// flush the journals every two seconds
+#define ABSTRACTJOURNAL_FLUSH_INTERVAL (2000)
+// fold a journal into its abstract file once it gets this big
+#define ABSTRACTJOURNAL_COMPACT_SIZE (16 * 1024)
+
+/*
+ * The changes made to an abstract since its text file was last written, one
+ * line each: "+value" for an added value and "-value" for a removed one.
+ *
+ * Changes are kept in memory and appended to the journal file together by
+ * flush(), which syncs the file to disk. compact() folds the journal into
+ * the text file, which is written to a temporary file and renamed over the
+ * old one, and then empties the journal.
+ *
+ * Replaying a change only says whether a value is in the abstract or not,
+ * so a journal can safely be replayed over a text file that already has it
+ * (say compact() was interrupted between the rename and emptying the
+ * journal). A last line cut short by a crash is dropped when the journal is
+ * first looked at.
+ *
+ * The journal has its own lock, but it only works on the files, never on
+ * the values the Abstract holds in memory. The Abstract has to be locked
+ * around compact(), or a load could map the text file before it is
+ * rewritten and then replay the journal after it has been emptied.
+ */
+class AbstractJournal
+{
+public:
+	AbstractJournal();
+	virtual ~AbstractJournal();
+
+	void setFiles(const String& base, const String& journal);
+
+	// recording
+	void record(bool add, const StringRef& value);
+	void record(bool add, const std::vector< StringRef >& values);
+	bool flush();
+
+	// information
+	bool isEmpty();
+	int size();
+
+	// loading
+	int replay(void (*apply)(void*, bool, const StringRef&), void* data);
+
+	// rewriting
+	bool compact();
+
+private:
+	// not copyable
+	AbstractJournal(const AbstractJournal& other);
+	AbstractJournal& operator=(const AbstractJournal& other);
+
+	bool write();
+	void recover();
+
+	String _base;
+	String _journal;
+	// changes that haven't been flushed yet
+	StringBuilder _pending;
+	// bytes in the journal file
+	int _size;
+	Mutex _mutex;
+};
+
+#endif
+
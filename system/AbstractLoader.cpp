@@ -0,0 +1,220 @@
+#include <AbstractLoader.h>
+#include <Abstract.h>
+#include <Timer.h>
+#include <bMotion.h>
+#include <Output.h>
+#include <algorithm>
+#include <vector>
+
+/*
+ * Internal callback for the loader thread.
+ * @param loader the AbstractLoader
+ */
+static void LoadAbstracts(void* loader)
+{
+	((AbstractLoader*)loader)->run();
+}
+
+/*
+ * Constructor. The thread isn't started until something is requested.
+ */
+AbstractLoader::AbstractLoader()
+: _thread(NULL)
+, _current(NULL)
+, _running(false)
+, _stopping(false)
+{
+
+}
+
+/*
+ * Destructor. Stops the thread.
+ */
+AbstractLoader::~AbstractLoader()
+{
+	stop();
+}
+
+/*
+ * start the thread if it isn't running. must be called with the lock held.
+ * @return true if the thread is running
+ */
+bool AbstractLoader::start()
+{
+	if (_running)
+		return true;
+	if (_stopping)
+		return false;
+	bMotionLog(1, "creating new abstract loader thread");
+	_thread = new Thread();
+	if (!_thread->create(LoadAbstracts, this))
+	{
+		bMotionLog(1, "abstracts will be loaded when they are used");
+		delete _thread;
+		_thread = NULL;
+		// don't try again every time
+		_stopping = true;
+		return false;
+	}
+	_running = true;
+	return true;
+}
+
+/*
+ * check if an abstract is queued or being loaded. must be called with the
+ * lock held.
+ * @param abstract the abstract
+ * @return true or false
+ */
+bool AbstractLoader::isPending(Abstract* abstract) const
+{
+	return abstract == _current ||
+		std::find(_queue.begin(), _queue.end(), abstract) !=
+		_queue.end();
+}
+
+/*
+ * queue an abstract to be loaded
+ * @param abstract the abstract
+ * @return true or false. false if there is no thread to load it, in which
+ * 	   case it is loaded when it is first used.
+ */
+bool AbstractLoader::request(Abstract* abstract)
+{
+	_mutex.lock();
+	bool running = start();
+	if (running && !isPending(abstract))
+	{
+		_queue.push_back(abstract);
+		_work.signal();
+	}
+	_mutex.unlock();
+	return running;
+}
+
+/*
+ * load an abstract ahead of everything else queued, and wait for it. if
+ * there is no thread the abstract is loaded here and now.
+ * @param abstract the abstract
+ * @param milli the most milliseconds to wait
+ * @return true if the abstract has been loaded (or failed to load), false
+ * 	   if it is still on its way
+ */
+bool AbstractLoader::waitFor(Abstract* abstract, unsigned long milli)
+{
+	_mutex.lock();
+	if (!start())
+	{
+		_mutex.unlock();
+		std::vector< Symbol > references;
+		if (abstract->load(references))
+			bMotionSystem().abstractLoaded(abstract);
+		return true;
+	}
+	if (abstract != _current)
+	{
+		std::deque< Abstract* >::iterator queued =
+			std::find(_queue.begin(), _queue.end(), abstract);
+		if (queued != _queue.end())
+			_queue.erase(queued);
+		_queue.push_front(abstract);
+		_work.signal();
+	}
+	_waiting.push_back(abstract);
+	TimerTime begin = Timer::now();
+	while (_running && isPending(abstract))
+	{
+		unsigned long elapsed =
+			(unsigned long)((Timer::now() - begin) / 1000000);
+		if (elapsed >= milli)
+			break;
+		_done.wait(_mutex, milli - elapsed);
+	}
+	_waiting.erase(std::find(_waiting.begin(), _waiting.end(), abstract));
+	bool loaded = !isPending(abstract);
+	_mutex.unlock();
+	return loaded;
+}
+
+/*
+ * stop the thread, dropping anything still queued. it waits for the
+ * abstract being loaded, if any, to finish.
+ */
+void AbstractLoader::stop()
+{
+	_mutex.lock();
+	_stopping = true;
+	_queue.clear();
+	_work.broadcast();
+	while (_running)
+		_done.wait(_mutex);
+	_mutex.unlock();
+	delete _thread;
+	_thread = NULL;
+}
+
+/*
+ * get the number of abstracts waiting to be loaded
+ * @return the number, counting one being loaded now
+ */
+int AbstractLoader::getQueued()
+{
+	_mutex.lock();
+	int queued = _queue.size() + (_current ? 1 : 0);
+	_mutex.unlock();
+	return queued;
+}
+
+/*
+ * the loader thread. loads queued abstracts until told to stop.
+ */
+void AbstractLoader::run()
+{
+	_mutex.lock();
+	while (!_stopping)
+	{
+		if (_queue.empty())
+		{
+			_work.wait(_mutex);
+			continue;
+		}
+		Abstract* abstract = _queue.front();
+		_queue.pop_front();
+		_current = abstract;
+		bool wanted = std::find(_waiting.begin(), _waiting.end(),
+				abstract) != _waiting.end();
+		_mutex.unlock();
+
+		std::vector< Symbol > references;
+		if (!wanted && !bMotionSystem().abstractAdmit(abstract))
+			bMotionLog(1, "not loading abstract '%s' yet, there is "
+					"no room for it",
+					(const char*)abstract->getType());
+		else if (abstract->load(references))
+			bMotionSystem().abstractLoaded(abstract);
+		// the ones it uses will be wanted soon
+		std::vector< Abstract* > next;
+		int size = references.size();
+		for (int i = 0; i < size; i++)
+		{
+			Abstract* found = bMotionSystem().findAbstract(
+					references[i]);
+			if (found && !found->isLoaded())
+				next.push_back(found);
+		}
+
+		_mutex.lock();
+		_current = NULL;
+		size = next.size();
+		for (int i = 0; i < size; i++)
+		{
+			if (!isPending(next[i]))
+				_queue.push_back(next[i]);
+		}
+		_done.broadcast();
+	}
+	_running = false;
+	_done.broadcast();
+	_mutex.unlock();
+}
+
@@ -0,0 +1,63 @@
+#ifndef ABSTRACTLOADER_H
+#define ABSTRACTLOADER_H
+
+#include <deque>
+#include <vector>
+#include <Thread.h>
+
+class Abstract;
+
+/*
+ * Loads abstracts on a thread of its own, so that reading an abstract file
+ * never holds up an event. Abstracts are queued with request() and loaded
+ * in turn; once one is loaded, the abstracts its values use with %VAR{} are
+ * queued as well. waitFor() lets an event wait a little while for one it
+ * needs right now.
+ *
+ * Abstracts that nobody is waiting for are only loaded if the AbstractCache
+ * lets them in, so prefetching can't push out the ones in use.
+ *
+ * The thread is started by the first request and runs until stop().
+ */
+class AbstractLoader
+{
+public:
+	AbstractLoader();
+	virtual ~AbstractLoader();
+
+	// loading
+	bool request(Abstract* abstract);
+	bool waitFor(Abstract* abstract, unsigned long milli);
+	void stop();
+
+	// information
+	int getQueued();
+
+	// thread body
+	void run();
+
+private:
+	// not copyable
+	AbstractLoader(const AbstractLoader& other);
+	AbstractLoader& operator=(const AbstractLoader& other);
+
+	bool start();
+	bool isPending(Abstract* abstract) const;
+
+	Thread* _thread;
+	Mutex _mutex;
+	// there is something in the queue, or it is time to stop
+	Condition _work;
+	// an abstract has been loaded, or the thread has finished
+	Condition _done;
+	std::deque< Abstract* > _queue;
+	// the abstract being loaded right now
+	Abstract* _current;
+	// abstracts that events are waiting for
+	std::vector< Abstract* > _waiting;
+	bool _running;
+	bool _stopping;
+};
+
+#endif
+
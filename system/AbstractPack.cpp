@@ -0,0 +1,461 @@
+#include <AbstractPack.h>
+#include <Output.h>
+#include <HashMap.h>
+#include <StringBuilder.h>
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifndef WIN32
+#include <dirent.h>
+#else
+#include <windows.h>
+#endif
+
+/*
+ * Constructor. Nothing is loaded until open() is called.
+ */
+AbstractPack::AbstractPack()
+: _count(0)
+, _strings(0)
+, _directory(0)
+, _offsets(0)
+, _data(0)
+{
+
+}
+
+/*
+ * Destructor
+ */
+AbstractPack::~AbstractPack()
+{
+	close();
+}
+
+/*
+ * map a pack file and check it over
+ * @param filename the pack file
+ * @return true if it is a good pack, false if it is missing or damaged
+ */
+bool AbstractPack::open(const String& filename)
+{
+	close();
+	if (!_file.open(filename))
+		return false;
+	if (!validate())
+	{
+		bMotionLog(1, "abstract pack \"%s\" is damaged, ignoring it",
+				(const char*)filename);
+		close();
+		return false;
+	}
+	bMotionLog(1, "using abstract pack \"%s\" (%d abstracts)",
+			(const char*)filename, _count);
+	return true;
+}
+
+/*
+ * unmap the pack. values got from it are no good after this.
+ */
+void AbstractPack::close()
+{
+	_file.close();
+	_count = 0;
+	_strings = 0;
+}
+
+/*
+ * check if a pack is loaded
+ * @return true or false
+ */
+bool AbstractPack::isOpen() const
+{
+	return _file.isOpen();
+}
+
+/*
+ * get the number of abstracts in the pack
+ * @return number of abstracts
+ */
+int AbstractPack::size() const
+{
+	return _count;
+}
+
+/*
+ * read a word out of the mapping
+ * @param offset where the word is, must be in the file
+ * @return the word
+ */
+unsigned int AbstractPack::word(unsigned int offset) const
+{
+	const unsigned char* p = (const unsigned char*)_file.getData() + offset;
+	return (unsigned int)p[0] | ((unsigned int)p[1] << 8) |
+		((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+/*
+ * get one of the strings
+ * @param index the string number, must be in range
+ * @param length set to the length of the string
+ * @return the string, NULL terminated
+ */
+const char* AbstractPack::string(unsigned int index, int& length) const
+{
+	unsigned int start = word(_offsets + index * 4);
+	length = word(_offsets + index * 4 + 4) - start - 1;
+	return _file.getData() + _data + start;
+}
+
+/*
+ * check the header, the checksum and that everything points inside the
+ * file, so that nothing later has to
+ * @return true if the pack is good
+ */
+bool AbstractPack::validate()
+{
+	unsigned int size = _file.size();
+	if (size < ABSTRACTPACK_HEADER_SIZE ||
+			memcmp(_file.getData(), ABSTRACTPACK_MAGIC, 4) != 0 ||
+			word(4) != ABSTRACTPACK_VERSION)
+		return false;
+	_count = word(8);
+	_strings = word(12);
+	_directory = word(16);
+	_offsets = word(20);
+	_data = word(24);
+	if (String::hash(_file.getData() + ABSTRACTPACK_HEADER_SIZE,
+				size - ABSTRACTPACK_HEADER_SIZE) != word(28))
+		return false;
+
+	// the sections are in order and don't overlap
+	if (_directory != ABSTRACTPACK_HEADER_SIZE ||
+			_count > (size - _directory) / ABSTRACTPACK_ENTRY_SIZE ||
+			_offsets != _directory + _count * ABSTRACTPACK_ENTRY_SIZE ||
+			_strings >= (size - _offsets) / 4 ||
+			_data != _offsets + (_strings + 1) * 4 || _data > size)
+		return false;
+
+	// every string has at least its NULL, and it is there
+	unsigned int last = 0;
+	for (unsigned int i = 0; i <= _strings; i++)
+	{
+		unsigned int offset = word(_offsets + i * 4);
+		if (offset > size - _data || (i > 0 && offset <= last) ||
+				(i == 0 && offset != 0))
+			return false;
+		if (i > 0 && _file.getData()[_data + offset - 1] != '\0')
+			return false;
+		last = offset;
+	}
+
+	// directory entries point at real strings
+	for (unsigned int i = 0; i < _count; i++)
+	{
+		unsigned int entry = _directory + i * ABSTRACTPACK_ENTRY_SIZE;
+		unsigned int first = word(entry + 4);
+		if (word(entry) >= _strings || first > _strings ||
+				word(entry + 8) > _strings - first)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * find an abstract by name
+ * @param name the name of the abstract
+ * @return the directory entry number, -1 if the pack doesn't have it
+ */
+int AbstractPack::find(const char* name) const
+{
+	if (!name)
+		return -1;
+	int low = 0;
+	int high = (int)_count - 1;
+	while (low <= high)
+	{
+		int middle = (low + high) / 2;
+		int length;
+		const char* test = string(word(_directory +
+					middle * ABSTRACTPACK_ENTRY_SIZE), length);
+		int compare = strcmp(test, name);
+		if (compare == 0)
+			return middle;
+		if (compare < 0)
+			low = middle + 1;
+		else
+			high = middle - 1;
+	}
+	return -1;
+}
+
+/*
+ * check that an abstract in the pack is still what its text file says
+ * @param entry the directory entry number
+ * @param source the text file the abstract was made from
+ * @return true if the text file hasn't changed since the pack was built
+ */
+bool AbstractPack::isFresh(int entry, const String& source) const
+{
+	struct stat info;
+	if (stat((const char*)source, &info) != 0)
+		return false;
+	unsigned int offset = _directory + entry * ABSTRACTPACK_ENTRY_SIZE;
+	return word(offset + 12) == (unsigned int)info.st_size &&
+		word(offset + 16) == (unsigned int)info.st_mtime;
+}
+
+/*
+ * get the values of an abstract. they are views into the pack, none of the
+ * string data is touched.
+ * @param entry the directory entry number
+ * @param values the values are added to this
+ */
+void AbstractPack::getValues(int entry, std::vector< StringRef >& values)
+		const
+{
+	unsigned int offset = _directory + entry * ABSTRACTPACK_ENTRY_SIZE;
+	unsigned int first = word(offset + 4);
+	unsigned int count = word(offset + 8);
+	values.reserve(values.size() + count);
+	for (unsigned int i = first; i < first + count; i++)
+	{
+		int length;
+		const char* value = string(i, length);
+		values.push_back(StringRef(value, length));
+	}
+}
+
+// one abstract on its way into a pack
+struct PackSource
+{
+	String name;
+	MappedFile* file;
+	std::vector< StringRef > values;
+	unsigned int size;
+	unsigned int mtime;
+};
+
+static bool sourceLess(const PackSource* a, const PackSource* b)
+{
+	return strcmp(a->name, b->name) < 0;
+}
+
+/*
+ * add a word to a pack being built
+ */
+static void appendWord(StringBuilder& out, unsigned int value)
+{
+	char bytes[4];
+	bytes[0] = (char)(value & 0xff);
+	bytes[1] = (char)((value >> 8) & 0xff);
+	bytes[2] = (char)((value >> 16) & 0xff);
+	bytes[3] = (char)((value >> 24) & 0xff);
+	out.append(bytes, 4);
+}
+
+/*
+ * add a string and its NULL to a pack being built
+ */
+static void appendString(StringBuilder& out, const char* text, int length)
+{
+	out.append(text, length);
+	out.append("", 1);
+}
+
+/*
+ * read one text abstract file the same way Abstract does: trimmed lines,
+ * no empty ones and no duplicates. lines with NULLs in them are left out.
+ * @param filename the text file
+ * @param source filled in
+ * @return true or false
+ */
+static bool readSource(const String& filename, PackSource& source)
+{
+	struct stat info;
+	if (stat((const char*)filename, &info) != 0)
+		return false;
+	source.size = info.st_size;
+	source.mtime = info.st_mtime;
+	source.file = new MappedFile();
+	if (!source.file->open(filename))
+		return false;
+	HashMap< StringRef, int, hashref, eqref > seen;
+	const char* p = source.file->getData();
+	const char* end = p + source.file->size();
+	while (p < end)
+	{
+		const char* eol = (const char*)memchr(p, '\n', end - p);
+		if (!eol)
+			eol = end;
+		StringRef line = StringRef(p, eol - p).trimmed();
+		p = eol + 1;
+		if (line.isEmpty() || memchr(line.getBuffer(), '\0',
+					line.length()))
+			continue;
+		if (seen.insert(line, 0))
+			source.values.push_back(line);
+	}
+	return true;
+}
+
+/*
+ * compile all the .txt abstracts in a directory into a pack. the pack is
+ * written next to the target and renamed over it, so a bot that has the
+ * old pack mapped carries on safely.
+ * @param directory the directory with the text files
+ * @param filename the pack file to write
+ * @return true or false
+ */
+bool AbstractPack::build(const String& directory, const String& filename)
+{
+	std::vector< PackSource* > sources;
+	bool success = true;
+#ifndef WIN32
+	String path = directory;
+	if (path.length() > 0 && path[path.length() - 1] != '/')
+		path.concat("/");
+	DIR* dir = opendir(directory);
+	if (!dir)
+	{
+		bMotionLog(1, "could not open abstract directory \"%s\"",
+				(const char*)directory);
+		return false;
+	}
+	struct dirent* entry;
+	while ((entry = readdir(dir)) != NULL)
+	{
+		String name(entry->d_name);
+#else
+	String path = directory;
+	if (path.length() > 0 && path[path.length() - 1] != '\\')
+		path.concat("\\");
+	String pattern = path;
+	pattern.concat("*.txt");
+	WIN32_FIND_DATA data;
+	HANDLE dir = FindFirstFile((const char*)pattern, &data);
+	if (dir == INVALID_HANDLE_VALUE)
+	{
+		bMotionLog(1, "could not open abstract directory \"%s\"",
+				(const char*)directory);
+		return false;
+	}
+	do
+	{
+		String name(data.cFileName);
+#endif
+		if (name.length() <= 4 || !name.endsWith(".txt"))
+			continue;
+		PackSource* source = new PackSource();
+		source->name = name.substring(0, name.length() - 4);
+		source->file = NULL;
+		sources.push_back(source);
+		String full = path;
+		full.concat(name);
+		if (!readSource(full, *source))
+		{
+			bMotionLog(1, "could not read abstract \"%s\"",
+					(const char*)full);
+			success = false;
+		}
+#ifndef WIN32
+	}
+	closedir(dir);
+#else
+	} while (FindNextFile(dir, &data));
+	FindClose(dir);
+#endif
+	std::sort(sources.begin(), sources.end(), sourceLess);
+
+	// names first, then the values of each abstract in turn
+	unsigned int count = sources.size();
+	unsigned int strings = count;
+	unsigned int i;
+	for (i = 0; i < count; i++)
+		strings += sources[i]->values.size();
+	unsigned int offsets = ABSTRACTPACK_HEADER_SIZE +
+		count * ABSTRACTPACK_ENTRY_SIZE;
+	unsigned int data = offsets + (strings + 1) * 4;
+
+	StringBuilder body;
+	StringBuilder text;
+	std::vector< unsigned int > starts;
+	starts.reserve(strings + 1);
+	for (i = 0; i < count; i++)
+	{
+		starts.push_back(text.length());
+		appendString(text, sources[i]->name,
+				sources[i]->name.length());
+	}
+	unsigned int value = count;
+	for (i = 0; i < count; i++)
+	{
+		PackSource* source = sources[i];
+		appendWord(body, i);
+		appendWord(body, value);
+		appendWord(body, source->values.size());
+		appendWord(body, source->size);
+		appendWord(body, source->mtime);
+		int size = source->values.size();
+		for (int j = 0; j < size; j++)
+		{
+			starts.push_back(text.length());
+			appendString(text, source->values[j].getBuffer(),
+					source->values[j].length());
+		}
+		value += size;
+	}
+	starts.push_back(text.length());
+	for (i = 0; i <= strings; i++)
+		appendWord(body, starts[i]);
+	body.append(text.getBuffer(), text.length());
+
+	StringBuilder header;
+	header.append(ABSTRACTPACK_MAGIC, 4);
+	appendWord(header, ABSTRACTPACK_VERSION);
+	appendWord(header, count);
+	appendWord(header, strings);
+	appendWord(header, ABSTRACTPACK_HEADER_SIZE);
+	appendWord(header, offsets);
+	appendWord(header, data);
+	appendWord(header, String::hash(body.getBuffer(), body.length()));
+
+	for (i = 0; i < count; i++)
+	{
+		delete sources[i]->file;
+		delete sources[i];
+	}
+	if (!success)
+		return false;
+
+	String temp = filename;
+	temp.concat(".tmp");
+	FILE* out = fopen(temp, "wb");
+	if (!out)
+	{
+		bMotionLog(1, "could not create \"%s\"", (const char*)temp);
+		return false;
+	}
+	success = fwrite(header.getBuffer(), 1, header.length(), out) ==
+		(size_t)header.length() &&
+		fwrite(body.getBuffer(), 1, body.length(), out) ==
+		(size_t)body.length();
+	if (fclose(out) != 0)
+		success = false;
+#ifdef WIN32
+	if (success)
+		remove(filename);
+#endif
+	if (!success || rename(temp, filename) != 0)
+	{
+		bMotionLog(1, "could not write \"%s\"", (const char*)filename);
+		remove(temp);
+		return false;
+	}
+	bMotionLog(1, "packed %d abstracts (%d values) into \"%s\"", count,
+			strings - count, (const char*)filename);
+	return true;
+}
+
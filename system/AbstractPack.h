@@ -0,0 +1,68 @@
+#ifndef ABSTRACTPACK_H
+#define ABSTRACTPACK_H
+
+#include <vector>
+#include <bString.h>
+#include <StringRef.h>
+#include <MappedFile.h>
+
+#define ABSTRACTPACK_MAGIC "bMAP"
+#define ABSTRACTPACK_VERSION (1)
+#define ABSTRACTPACK_HEADER_SIZE (32)
+#define ABSTRACTPACK_ENTRY_SIZE (20)
+
+/*
+ * All the abstracts of one language compiled into a single file, made by
+ * tools/bmotionpack from the .txt files in abstracts/<lang> and loaded by
+ * mapping it.
+ * All numbers are 32 bit little endian words.
+ *
+ *   header     "bMAP", version, abstract count, string count, directory
+ *              offset, string offset table offset, string data offset,
+ *              checksum (xxHash32 of everything after the header)
+ *   directory  one entry per abstract, sorted by name: name string,
+ *              first value string, value count, size and modification
+ *              time of the text file it was made from
+ *   offsets    string count + 1 words. string i runs from offset i up to
+ *              offset i + 1, the last byte of which is a NULL
+ *   data       the strings
+ *
+ * The text files stay the master copy. An abstract is only taken from the
+ * pack while its text file has the size and time recorded in the pack, so
+ * anything added or removed since the pack was built is never lost.
+ */
+class AbstractPack
+{
+public:
+	AbstractPack();
+	virtual ~AbstractPack();
+
+	// loading
+	bool open(const String& filename);
+	void close();
+	bool isOpen() const;
+
+	// lookup
+	int size() const;
+	int find(const char* name) const;
+	bool isFresh(int entry, const String& source) const;
+	void getValues(int entry, std::vector< StringRef >& values) const;
+
+	// building
+	static bool build(const String& directory, const String& filename);
+
+private:
+	unsigned int word(unsigned int offset) const;
+	const char* string(unsigned int index, int& length) const;
+	bool validate();
+
+	MappedFile _file;
+	unsigned int _count;
+	unsigned int _strings;
+	unsigned int _directory;
+	unsigned int _offsets;
+	unsigned int _data;
+};
+
+#endif
+
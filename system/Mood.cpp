@@ -105,7 +105,6 @@ void Mood::decrease(int amount)
 void bMotionMoodDrift(void*)
 {
 	bMotionSystem().moodDrift();
-	bMotionSystem().addTimer(1000, bMotionMoodDrift, NULL);
 }
 
 /*
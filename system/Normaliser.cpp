@@ -0,0 +1,161 @@
+#include <Normaliser.h>
+#include <string.h>
+#include <ctype.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+ * Constructor
+ */
+Normaliser::Normaliser()
+: _buffer(NULL)
+, _alloc(0)
+, _length(0)
+{
+
+}
+
+/*
+ * Destructor
+ */
+Normaliser::~Normaliser()
+{
+	delete [] _buffer;
+}
+
+/*
+ * length of the last normalised line
+ * @return length in bytes
+ */
+int Normaliser::length() const
+{
+	return _length;
+}
+
+/*
+ * skip the colour numbers after a colour code, mIRC style: up to two digits
+ * of foreground, then optionally a comma and up to two digits of background.
+ * @param text the text just after the colour code
+ * @return the first character after the colour numbers
+ */
+static const char* skipColour(const char* text)
+{
+	if (!isdigit((unsigned char)*text))
+		return text;
+	text++;
+	if (isdigit((unsigned char)*text))
+		text++;
+	if (text[0] == ',' && isdigit((unsigned char)text[1]))
+	{
+		text += 2;
+		if (isdigit((unsigned char)*text))
+			text++;
+	}
+	return text;
+}
+
+/*
+ * check for an IRC formatting code
+ * @param c the character
+ * @return true or false
+ */
+static bool isCode(char c)
+{
+	return c == '\002' || c == '\003' || c == '\017' || c == '\022' ||
+		c == '\026' || c == '\037';
+}
+
+/*
+ * normalise a line of text
+ * @param text the line
+ * @param flags a combination of the NORMALISE_ flags
+ * @return the normalised line, good until the next call
+ */
+const char* Normaliser::normalise(const char* text, int flags)
+{
+	if (!text)
+		text = "";
+	int len = strlen(text);
+	if (len + 1 > _alloc)
+	{
+		delete [] _buffer;
+		for (_alloc = 64; _alloc < len + 1; _alloc <<= 1);
+		_buffer = new char[_alloc];
+	}
+
+	bool strip = (flags & NORMALISE_STRIP_CODES) != 0;
+	bool trim = (flags & NORMALISE_TRIM) != 0;
+	bool collapse = (flags & NORMALISE_COLLAPSE_SPACES) != 0;
+	const char* end = text + len;
+	const char* p = text;
+	char* out = _buffer;
+
+	while (p < end)
+	{
+#ifdef __SSE2__
+		// copy 16 bytes at a time while there is nothing to do in them.
+		// only control characters and a space after a space matter.
+		if (out > _buffer && (!collapse || out[-1] != ' ' || *p != ' '))
+		{
+			const __m128i limit = _mm_set1_epi8(0x1f);
+			const __m128i space = _mm_set1_epi8(' ');
+			while (end - p > 16)
+			{
+				__m128i chunk = _mm_loadu_si128((const __m128i*)p);
+				__m128i special = _mm_cmpeq_epi8(
+						_mm_min_epu8(chunk, limit), chunk);
+				if (collapse)
+				{
+					__m128i next = _mm_loadu_si128(
+							(const __m128i*)(p + 1));
+					special = _mm_or_si128(special, _mm_and_si128(
+							_mm_cmpeq_epi8(chunk, space),
+							_mm_cmpeq_epi8(next, space)));
+				}
+				int mask = _mm_movemask_epi8(special);
+				if (mask == 0)
+				{
+					_mm_storeu_si128((__m128i*)out, chunk);
+					p += 16;
+					out += 16;
+					continue;
+				}
+				// copy up to the first interesting byte and let
+				// the code below deal with it
+				int n = 0;
+				while (!(mask & (1 << n)))
+					n++;
+				memcpy(out, p, n);
+				p += n;
+				out += n;
+				break;
+			}
+			if (p >= end)
+				break;
+		}
+#endif
+		char c = *p++;
+		if (strip && isCode(c))
+		{
+			if (c == '\003')
+				p = skipColour(p);
+			continue;
+		}
+		if (trim && out == _buffer && isspace((unsigned char)c))
+			continue;
+		if (collapse && c == ' ' && out > _buffer && out[-1] == ' ')
+			continue;
+		*out++ = c;
+	}
+
+	if (trim)
+	{
+		while (out > _buffer && isspace((unsigned char)out[-1]))
+			out--;
+	}
+	*out = '\0';
+	_length = out - _buffer;
+	return _buffer;
+}
+
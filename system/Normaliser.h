@@ -0,0 +1,35 @@
+#ifndef NORMALISER_H
+#define NORMALISER_H
+
+// what Normaliser::normalise() should do
+#define NORMALISE_STRIP_CODES (1)
+#define NORMALISE_TRIM (2)
+#define NORMALISE_COLLAPSE_SPACES (4)
+
+/*
+ * cleans up incoming lines in a single pass: strips the IRC formatting codes
+ * (bold, colour, reset, reverse, underline), trims white space off both ends
+ * and squeezes runs of spaces down to one. the result is written into a
+ * buffer that is reused from line to line.
+ */
+class Normaliser
+{
+public:
+	Normaliser();
+	virtual ~Normaliser();
+
+	const char* normalise(const char* text, int flags);
+	int length() const;
+
+private:
+	// not copyable
+	Normaliser(const Normaliser& other);
+	Normaliser& operator=(const Normaliser& other);
+
+	char* _buffer;
+	int _alloc;
+	int _length;
+};
+
+#endif
+
@@ -35,7 +35,15 @@ bool bMotionDoInterpolation(String& line, const String& /*nick*/,
 		int pos2 = line.indexOf("}", pos);
 		String type = line.substring(pos + 5, pos2);
 		bMotionLog(1, "type == %s", (const char*)type);
-		String val = bMotionSystem().abstractGetValue(type);
+		bool loading = false;
+		String val = bMotionSystem().abstractGetValue(type, loading);
+		if (loading)
+		{
+			// better to say nothing than keep everything else waiting
+			bMotionLog(1, "bMotion: abstract %s is still loading, "
+					"dropping line", (const char*)type);
+			return false;
+		}
 		if (val.length() == 0)
 		{
 			bMotionLog(1, "bMotion: ALERT! empty abstract returned");
@@ -151,13 +159,13 @@ extern "C" bool bMotionDoAction(const char* channel, const char* nick,
 			return false;
 		return internal_DoAction(channel, nick, text, moreText, urgent);
 	}
-	std::vector< String > channels = bMotionSettings().channels();
+	const std::vector< Symbol >& channels = bMotionSettings().channels();
 	bool success = false;
 	for (unsigned int i = 0; i < channels.size(); i++)
 	{
 		if (bMotionSettings().isChannelSilent(channels[i]))
 			continue;
-		if (internal_DoAction(channels[i], nick, text, moreText,
+		if (internal_DoAction(channels[i].getName(), nick, text, moreText,
 					urgent))
 			success = true;
 	}
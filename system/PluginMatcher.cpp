@@ -0,0 +1,216 @@
+#include <PluginMatcher.h>
+#include <Plugin.h>
+#include <Output.h>
+#include <algorithm>
+
+/*
+ * Constructor. Creates an empty bucket.
+ */
+PluginMatcher::PluginMatcher()
+: _fallbacks(0)
+, _lines(0)
+, _regexecCalls(0)
+, _regexecSaved(0)
+, _dirty(false)
+{
+
+}
+
+/*
+ * Destructor. Does not delete the plugins.
+ */
+PluginMatcher::~PluginMatcher()
+{
+
+}
+
+/*
+ * add a plugin to the matcher
+ * @param plugin the plugin to add
+ * @param order the registration order of the plugin, plugins are matched in
+ * 	  this order.
+ */
+void PluginMatcher::add(Plugin* plugin, unsigned long order)
+{
+	_mutex.lock();
+	if (_orders.empty() || order > _orders.back())
+	{
+		_plugins.push_back(plugin);
+		_orders.push_back(order);
+		if (!_dirty)
+			compile(_plugins.size() - 1);
+	}
+	else
+	{
+		int pos = std::lower_bound(_orders.begin(), _orders.end(), order) -
+			_orders.begin();
+		_plugins.insert(_plugins.begin() + pos, plugin);
+		_orders.insert(_orders.begin() + pos, order);
+		_dirty = true;
+	}
+	_mutex.unlock();
+}
+
+/*
+ * take a plugin out of the matcher
+ * @param plugin the plugin to remove
+ * @return true if the plugin was in the matcher, false otherwise
+ */
+bool PluginMatcher::remove(Plugin* plugin)
+{
+	_mutex.lock();
+	std::vector< Plugin* >::iterator pos = std::find(_plugins.begin(),
+			_plugins.end(), plugin);
+	bool found = pos != _plugins.end();
+	if (found)
+	{
+		_orders.erase(_orders.begin() + (pos - _plugins.begin()));
+		_plugins.erase(pos);
+		_dirty = true;
+	}
+	_mutex.unlock();
+	return found;
+}
+
+/*
+ * remove all of the plugins from the matcher.
+ */
+void PluginMatcher::clear()
+{
+	_mutex.lock();
+	_plugins.clear();
+	_orders.clear();
+	rebuild();
+	_mutex.unlock();
+}
+
+/*
+ * compile a plugin that is in _plugins into the set or the literal
+ * prefilter. the mutex must be held.
+ * @param index the index of the plugin in _plugins
+ */
+void PluginMatcher::compile(int index)
+{
+	Plugin* plugin = _plugins[index];
+	bool inSet = _set.add(plugin->getRegexp(), index);
+	_inSet.push_back(inSet);
+	String literal;
+	bool filtered = false;
+	if (!inSet)
+	{
+		_fallbacks++;
+		filtered = LiteralSet::requiredLiteral(plugin->getRegexp(),
+				literal);
+		if (filtered)
+			_literals.add(literal, index);
+	}
+	_filtered.push_back(filtered);
+}
+
+/*
+ * compile all of the plugins again. the mutex must be held.
+ */
+void PluginMatcher::rebuild()
+{
+	_set.clear();
+	_literals.clear();
+	_inSet.clear();
+	_filtered.clear();
+	_fallbacks = 0;
+	int size = _plugins.size();
+	for (int i = 0; i < size; i++)
+		compile(i);
+	_dirty = false;
+	if (size > 0)
+		bMotionLog(2, "plugin matcher rebuilt with %d plugins "
+				"(%d on their own)", size, _fallbacks);
+}
+
+/*
+ * get the number of plugins in the matcher
+ * @return plugin count
+ */
+int PluginMatcher::size() const
+{
+	return _plugins.size();
+}
+
+/*
+ * get the number of plugins that are matched on their own
+ * @return plugin count
+ */
+int PluginMatcher::fallbackCount() const
+{
+	return _fallbacks;
+}
+
+/*
+ * get the number of lines matched since the matcher was created
+ * @return line count
+ */
+unsigned long PluginMatcher::getLines() const
+{
+	return _lines;
+}
+
+/*
+ * get the number of times a plugin regular expression was run on its own
+ * @return regexec call count
+ */
+unsigned long PluginMatcher::getRegexecCalls() const
+{
+	return _regexecCalls;
+}
+
+/*
+ * get the number of times a plugin regular expression didn't need to be run
+ * on its own because its literal wasn't in the text
+ * @return regexec calls saved
+ */
+unsigned long PluginMatcher::getRegexecSaved() const
+{
+	return _regexecSaved;
+}
+
+/*
+ * find all the plugins whose regular expressions match the text.
+ * @param text the text to test
+ * @param answer filled with the matching plugins, in registration order.
+ */
+void PluginMatcher::match(const StringRef& text,
+		std::vector< Plugin* >& answer)
+{
+	answer.clear();
+	_mutex.lock();
+	if (_dirty)
+		rebuild();
+	int size = _plugins.size();
+	if (size == 0)
+	{
+		_mutex.unlock();
+		return;
+	}
+	_set.scan(text.getBuffer(), text.length(), _matched);
+	if (_literals.size() > 0)
+		_literals.scan(text.getBuffer(), text.length(), _found);
+	_lines++;
+	for (int i = 0; i < size; i++)
+	{
+		Plugin* plugin = _plugins[i];
+		if (_inSet[i])
+		{
+			if (_matched[i])
+				answer.push_back(plugin);
+		}
+		else if (_filtered[i] && !_found[i])
+			_regexecSaved++;
+		else
+		{
+			_regexecCalls++;
+			if (plugin->matches(text))
+				answer.push_back(plugin);
+		}
+	}
+	_mutex.unlock();
+}
+
@@ -0,0 +1,69 @@
+#ifndef PLUGINMATCHER_H
+#define PLUGINMATCHER_H
+
+#include <vector>
+#include <PatternSet.h>
+#include <LiteralSet.h>
+#include <Thread.h>
+#include <bString.h>
+#include <StringRef.h>
+
+class Plugin;
+
+/*
+ * a bucket of plugins that matches text against all of their regular
+ * expressions in one go. plugins are kept in registration order. plugins
+ * whose regular expression can't go into the PatternSet are matched on their
+ * own, but only when a literal their expression needs is in the text.
+ *
+ * appending a plugin compiles it straight into the set, anything else marks
+ * the set out of date and it is compiled again before the next match.
+ */
+class PluginMatcher
+{
+public:
+	PluginMatcher();
+	virtual ~PluginMatcher();
+
+	// building
+	void add(Plugin* plugin, unsigned long order);
+	bool remove(Plugin* plugin);
+	void clear();
+
+	// information
+	int size() const;
+	int fallbackCount() const;
+	unsigned long getLines() const;
+	unsigned long getRegexecCalls() const;
+	unsigned long getRegexecSaved() const;
+
+	// matching
+	void match(const StringRef& text, std::vector< Plugin* >& answer);
+
+private:
+	void compile(int index);
+	void rebuild();
+
+	// plugins and their registration order, in that order
+	std::vector< Plugin* > _plugins;
+	std::vector< unsigned long > _orders;
+	// true where the plugin is in _set, false if it needs its own match
+	std::vector< bool > _inSet;
+	int _fallbacks;
+	PatternSet _set;
+	std::vector< bool > _matched;
+	// required literals of the plugins matched on their own
+	std::vector< bool > _filtered;
+	LiteralSet _literals;
+	std::vector< bool > _found;
+	// statistics
+	unsigned long _lines;
+	unsigned long _regexecCalls;
+	unsigned long _regexecSaved;
+	// the compiled set doesn't reflect _plugins
+	bool _dirty;
+	Mutex _mutex;
+};
+
+#endif
+
@@ -2,7 +2,43 @@
 #include <bString.h>
 #include <File.h>
 #include <Output.h>
+#include <TimerPool.h>
 #include <algorithm>
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+
+/*
+ * read a setting that has to be a positive whole number. a bad value is
+ * logged and the setting left as it was.
+ * @param token the name of the setting
+ * @param value the value given for it
+ * @param max the largest it can be, anything bigger is cut down to this
+ * @param setting where to put it
+ */
+static void parseCount(const String& token, const String& value,
+		unsigned long max, unsigned int& setting)
+{
+	if (max > UINT_MAX)
+		max = UINT_MAX;
+	const char* text = value;
+	char* end;
+	errno = 0;
+	long count = strtol(text, &end, 10);
+	if (end == text || *end != '\0' || errno == ERANGE || count <= 0)
+	{
+		bMotionLog(1, "bad %s value \"%s\", keeping %u",
+				(const char*)token, text, setting);
+		return;
+	}
+	if ((unsigned long)count > max)
+	{
+		bMotionLog(1, "%s value %ld is too big, using %lu",
+				(const char*)token, count, max);
+		count = max;
+	}
+	setting = count;
+}
 
 /*
  * Default Settings constructor
@@ -17,6 +53,9 @@ Settings::Settings()
 , _language(en)
 , _pluginpath("./plugins")
 , _abstractpath("./abstracts")
+, _abstractbudget(4096)
+, _timers(Heap)
+, _timerworkers(2)
 {
 
 }
@@ -26,7 +65,13 @@ Settings::Settings()
  */
 Settings::~Settings()
 {
-
+	HashMap< String, String*, hashstr, eqstr >::iterator iter =
+		_settings.begin();
+	while (iter != _settings.end())
+	{
+		delete iter->second;
+		++iter;
+	}
 }
 
 /*
@@ -141,6 +186,25 @@ bool Settings::parseConfigFile(const String& filename)
 			{
 				_abstractpath = value;
 			}
+			else if (token.equals("abstractBudget"))
+				// in kilobytes, it is multiplied up to bytes
+				parseCount(token, value, ULONG_MAX / 1024,
+						_abstractbudget);
+			else if (token.equals("timers"))
+			{
+				if (value.equals("heap"))
+					_timers = Heap;
+				else if (value.equals("wheel"))
+					_timers = Wheel;
+				else
+				{
+					bMotionLog(1, "unknown timers value \"%s\"", (const char*)value);
+					return false;
+				}
+			}
+			else if (token.equals("timerWorkers"))
+				parseCount(token, value, TIMERPOOL_MAX_WORKERS,
+						_timerworkers);
 			else if (token.equals("channels"))
 			{
 				int p = value.indexOf(',');
@@ -150,10 +214,10 @@ bool Settings::parseConfigFile(const String& filename)
 					value = value.substring(p + 1);
 					ch.trim();
 					value.trim();
-					_channels.push_back(ch);
+					_channels.push_back(Symbol(ch));
 					p = value.indexOf(',');
 				}
-				_channels.push_back(value);
+				_channels.push_back(Symbol(value));
 			}
 			else if (token.equals("silent"))
 			{
@@ -164,10 +228,10 @@ bool Settings::parseConfigFile(const String& filename)
 					value = value.substring(p + 1);
 					ch.trim();
 					value.trim();
-					_silent.push_back(ch);
+					_silent.push_back(Symbol(ch));
 					p = value.indexOf(',');
 				}
-				_silent.push_back(value);
+				_silent.push_back(Symbol(value));
 			}
 			else if (token.equals("noplugin"))
 			{
@@ -178,10 +242,10 @@ bool Settings::parseConfigFile(const String& filename)
 					value = value.substring(p + 1);
 					plugin.trim();
 					value.trim();
-					_noplugin.push_back(plugin);
+					_noplugin.push_back(Symbol(plugin));
 					p = value.indexOf(',');
 				}
-				_noplugin.push_back(value);
+				_noplugin.push_back(Symbol(value));
 			}
 			else if (token.equals("minRandomDelay"))
 				_minrandomdelay = atoi(value);
@@ -219,6 +283,9 @@ void Settings::dump()
 	bMotionLog(1, "  Lanuage == %s", (_language == en ? "English" : (_language == fr ? "French" : "Dutch")));
 	bMotionLog(1, "  Plugins Path == %s", (const char*)_pluginpath);
 	bMotionLog(1, "  Abstracts Path == %s", (const char*)_abstractpath);
+	bMotionLog(1, "  abstractBudget == %u KB", _abstractbudget);
+	bMotionLog(1, "  timers == %s", (_timers == Heap ? "heap" : "wheel"));
+	bMotionLog(1, "  timerWorkers == %u", _timerworkers);
 	bMotionLog(1, "  minRandomDelay == %d", _minrandomdelay);
 	bMotionLog(1, "  maxRandomDelay == %d", _maxrandomdelay);
 	bMotionLog(1, "  Channels:");
@@ -242,15 +309,15 @@ void Settings::dump()
 		bMotionLog(1, "    (none)");
 	bMotionLog(1, "--User");
 	bMotionLog(1, "  Generic Settings:");
-	std::map< String, String, ltstr >::iterator iter;
+	HashMap< String, String*, hashstr, eqstr >::iterator iter;
 	iter = _settings.begin();
 	if (iter == _settings.end())
 		bMotionLog(1, "    (none)");
 	while (iter != _settings.end())
 	{
 		bMotionLog(1, "    %s == %s", (const char*)iter->first,
-				(const char*)iter->second);
-		iter++;
+				(const char*)*iter->second);
+		++iter;
 	}
 }
 
@@ -322,7 +389,21 @@ const String& Settings::abstractPath() const
  * @param channel channel name for which to test
  * @return true or false
  */
-bool Settings::isChannelAllowed(const String& channel) const
+bool Settings::isChannelAllowed(const char* channel) const
+{
+	// a name that was never interned can't be in the list
+	Symbol symbol = Symbol::find(channel);
+	if (symbol.isEmpty())
+		return false;
+	return isChannelAllowed(symbol);
+}
+
+/*
+ * check if a given channel is in the settings as an allowed channel
+ * @param channel interned channel name for which to test
+ * @return true or false
+ */
+bool Settings::isChannelAllowed(const Symbol& channel) const
 {
 	return (std::find(_channels.begin(), _channels.end(), channel) !=
 		_channels.end());
@@ -333,7 +414,20 @@ bool Settings::isChannelAllowed(const String& channel) const
  * @param channel channel name for which to test
  * @return true or false
  */
-bool Settings::isChannelSilent(const String& channel) const
+bool Settings::isChannelSilent(const char* channel) const
+{
+	Symbol symbol = Symbol::find(channel);
+	if (symbol.isEmpty())
+		return false;
+	return isChannelSilent(symbol);
+}
+
+/*
+ * check if a given channel is in the settings as a silent channel
+ * @param channel interned channel name for which to test
+ * @return true or false
+ */
+bool Settings::isChannelSilent(const Symbol& channel) const
 {
 	return (std::find(_silent.begin(), _silent.end(), channel) !=
 		_silent.end());
@@ -344,7 +438,20 @@ bool Settings::isChannelSilent(const String& channel) const
  * @param plugin the name of the plugin
  * @return true or false
  */
-bool Settings::isPluginAllowed(const String& plugin) const
+bool Settings::isPluginAllowed(const char* plugin) const
+{
+	Symbol symbol = Symbol::find(plugin);
+	if (symbol.isEmpty())
+		return true;
+	return isPluginAllowed(symbol);
+}
+
+/*
+ * check if a plugin (by name) is allowed or on the disallowed list
+ * @param plugin the interned name of the plugin
+ * @return true or false
+ */
+bool Settings::isPluginAllowed(const Symbol& plugin) const
 {
 	return (std::find(_noplugin.begin(), _noplugin.end(), plugin) ==
 		_noplugin.end());
@@ -368,6 +475,33 @@ unsigned int Settings::maxRandomDelay() const
 	return _maxrandomdelay;
 }
 
+/*
+ * get the memory loaded abstracts may take up
+ * @return the budget in kilobytes
+ */
+unsigned int Settings::abstractBudget() const
+{
+	return _abstractbudget;
+}
+
+/*
+ * get the kind of queue to keep timers in
+ * @return Heap or Wheel
+ */
+TimerScheme Settings::timers() const
+{
+	return _timers;
+}
+
+/*
+ * get the number of threads that run timer callbacks
+ * @return the number, at most TIMERPOOL_MAX_WORKERS
+ */
+unsigned int Settings::timerWorkers() const
+{
+	return _timerworkers;
+}
+
 /*
  * set the language of the system
  * @param lang the new system language
@@ -388,25 +522,31 @@ bool Settings::setLanguage(Language lang)
  */
 bool Settings::set(const String& setting, const String& value)
 {
-	_settings[setting] = value;
+	get(setting) = value;
 	return true;
 }
 
 /*
- * get a user defined setting
+ * get a user defined setting. a setting that doesn't exist yet is created
+ * empty.
  * @param setting the name of the setting
  * @return the value of the setting
  */
 String& Settings::get(const String& setting)
 {
-	return _settings[setting];
+	String** value = _settings.find(setting);
+	if (value)
+		return **value;
+	String* created = new String();
+	_settings.insert(setting, created);
+	return *created;
 }
 
 /*
  * get the allowed channels
  * @return a vector of allowed channels
  */
-std::vector< String > Settings::channels() const
+const std::vector< Symbol >& Settings::channels() const
 {
 	return _channels;
 }
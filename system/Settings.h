@@ -2,15 +2,20 @@
 #define SETTINGS_H
 
 #include <vector>
-#include <map>
 #include <bString.h>
+#include <Symbol.h>
+#include <HashMap.h>
 
 // gender type
 enum Gender { Male = 0, Female };
 // orientation type
 enum Orientation { Straight = 0, Gay, Bi };
+// timer queue type
+enum TimerScheme { Heap = 0, Wheel };
 // language type
 enum Language { any = 0, en, fr, nl };
+// number of languages, including any
+#define LANGUAGE_COUNT (nl + 1)
 
 /*
  * Settings class for system wide settings. NOTE: individual plugin settings
@@ -36,11 +41,17 @@ public:
 	Language language() const;
 	const String& pluginPath() const;
 	const String& abstractPath() const;
-	bool isChannelAllowed(const String& channel) const;
-	bool isChannelSilent(const String& channel) const;
-	bool isPluginAllowed(const String& plugin) const;
+	bool isChannelAllowed(const char* channel) const;
+	bool isChannelAllowed(const Symbol& channel) const;
+	bool isChannelSilent(const char* channel) const;
+	bool isChannelSilent(const Symbol& channel) const;
+	bool isPluginAllowed(const char* plugin) const;
+	bool isPluginAllowed(const Symbol& plugin) const;
 	unsigned int maxRandomDelay() const;
 	unsigned int minRandomDelay() const;
+	unsigned int abstractBudget() const;
+	TimerScheme timers() const;
+	unsigned int timerWorkers() const;
 
 	// set
 	bool setLanguage(Language lang);
@@ -48,7 +59,7 @@ public:
 
 	// get
 	String& get(const String& setting);
-	std::vector< String > channels() const;
+	const std::vector< Symbol >& channels() const;
 
 	// utility
 	static Language getLanguageFromString(const String& langstr);
@@ -69,12 +80,18 @@ private:
 	Language _language;
 	String _pluginpath;
 	String _abstractpath;
-	std::vector< String > _channels;
-	std::vector< String > _silent;
-	std::vector< String > _noplugin;
+	// memory for loaded abstracts, in kilobytes
+	unsigned int _abstractbudget;
+	TimerScheme _timers;
+	// threads running timer callbacks
+	unsigned int _timerworkers;
+	std::vector< Symbol > _channels;
+	std::vector< Symbol > _silent;
+	std::vector< Symbol > _noplugin;
 
-	// generic settings
-	std::map< String, String, ltstr > _settings;
+	// generic settings. the values are held by pointer so that they stay
+	// put when the table grows, bMotionGet() hands them out
+	HashMap< String, String*, hashstr, eqstr > _settings;
 };
 
 #endif
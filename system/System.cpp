@@ -3,6 +3,9 @@
 #include <SimplePlugin.h>
 #include <ComplexPlugin.h>
 #include <Output.h>
+#include <RegexCache.h>
+#include <TimerHeap.h>
+#include <TimerWheel.h>
 #include <bMotion.h>
 #include <time.h>
 #ifndef WIN32
@@ -15,12 +18,40 @@
  * Default System constructor
  */
 System::System()
-: _activeLib(NULL)
+: _timers(NULL)
+, _nextOrder(0)
 , _timerThread(NULL)
-, _segfault(false)
+, _timerRunning(false)
+, _timerStopping(false)
+, _nextTimer(0)
+, _timerPool(NULL)
+, _dangerous(0)
 {
 	// initialise the random seed
 	srand((unsigned)time(NULL));
+	for (int i = 0; i < LANGUAGE_COUNT; i++)
+	{
+		_packs[i] = NULL;
+		_packTried[i] = false;
+	}
+	for (int i = 0; i < PLUGINTYPE_COUNT * LANGUAGE_COUNT *
+			EVENTTYPE_COUNT; i++)
+		_buckets[i] = NULL;
+	for (int type = 0; type < PLUGINTYPE_COUNT; type++)
+	{
+		for (int lang = 0; lang < LANGUAGE_COUNT; lang++)
+		{
+			for (int event = 0; event < EVENTTYPE_COUNT; event++)
+			{
+				if (type != Event && event != Unknown)
+					break;
+				_buckets[getBucketKey((PluginType)type,
+						(Language)lang,
+						(EventType)event)] =
+					new PluginMatcher();
+			}
+		}
+	}
 }
 
 /*
@@ -38,15 +69,27 @@ System::~System()
 	s = _plugins.size();
 	for (i = 0; i < s; i++)
 		delete _plugins[i];
-	std::map< String, Abstract*, ltstr>::iterator iter = _abstracts.begin();
+	// the loader may be in the middle of one
+	_loader.stop();
+	HashMap< Symbol, Abstract*, hashsym, eqsym >::iterator iter =
+		_abstracts.begin();
 	while (iter != _abstracts.end())
 	{
 		delete iter->second;
-		iter++;
+		++iter;
 	}
+	// after the abstracts, they may be looking into the packs
+	for (i = 0; i < LANGUAGE_COUNT; i++)
+		delete _packs[i];
 	s = _moods.size();
 	for (i = 0; i < s; i++)
 		delete _moods[i];
+	for (i = 0; i < PLUGINTYPE_COUNT * LANGUAGE_COUNT * EVENTTYPE_COUNT;
+			i++)
+		delete _buckets[i];
+	s = _contexts.size();
+	for (i = 0; i < s; i++)
+		delete _contexts[i];
 }
 
 /*
@@ -61,7 +104,66 @@ void System::dump()
 		active += _plugins[i]->isEnabled();
 	bMotionLog(1, "  %d plugins loaded (%d active, %d inactive)", 
 			_plugins.size(), active, _plugins.size() - active);
-	bMotionLog(1, "  %d timers active", _timers.size());
+	int fallbacks = 0;
+	unsigned long lines = 0;
+	unsigned long calls = 0;
+	unsigned long saved = 0;
+	int indexed = 0;
+	int buckets = 0;
+	for (int i = 0; i < PLUGINTYPE_COUNT * LANGUAGE_COUNT *
+			EVENTTYPE_COUNT; i++)
+	{
+		PluginMatcher* bucket = _buckets[i];
+		if (!bucket || bucket->size() == 0)
+			continue;
+		buckets++;
+		indexed += bucket->size();
+		fallbacks += bucket->fallbackCount();
+		lines += bucket->getLines();
+		calls += bucket->getRegexecCalls();
+		saved += bucket->getRegexecSaved();
+	}
+	bMotionLog(1, "  %d plugin buckets holding %d entries (%d matched on "
+			"their own)", buckets, indexed, fallbacks);
+	if (lines > 0)
+		bMotionLog(1, "  %lu lines matched, %.2f regexec calls per line "
+				"(%.2f saved by literal prefilter)", lines,
+				(double)calls / lines, (double)saved / lines);
+	RegexCache& regexes = RegexCache::shared();
+	bMotionLog(1, "  %d/%d regexps cached (%lu hits, %lu misses, "
+			"%lu evictions)", regexes.size(), regexes.getCapacity(),
+			regexes.getHits(), regexes.getMisses(),
+			regexes.getEvictions());
+	unsigned long hits = _cache.getHits();
+	unsigned long uses = hits + _cache.getMisses();
+	bMotionLog(1, "  %d abstracts loaded, %lu/%u KB (%.1f%% hit ratio, "
+			"%lu evictions)", _cache.size(),
+			_cache.getResident() / 1024,
+			bMotionSettings().abstractBudget(),
+			uses ? 100.0 * hits / uses : 0.0,
+			_cache.getEvictions());
+	bMotionLog(1, "  %d abstracts waiting to be loaded",
+			_loader.getQueued());
+	for (int i = 0; i < LANGUAGE_COUNT; i++)
+	{
+		if (_packs[i])
+			bMotionLog(1, "  %s abstract pack holds %d abstracts",
+					(const char*)Settings::
+					getStringFromLanguage((Language)i),
+					_packs[i]->size());
+	}
+	_timerMutex.lock();
+	int timers = _timers ? _timers->size() : 0;
+	TimerPool* pool = _timerPool;
+	_timerMutex.unlock();
+	bMotionLog(1, "  %d timers active", timers);
+	if (pool)
+		bMotionLog(1, "  %lu timer callbacks run by %d workers "
+				"(%lu stolen), waited %.2f ms (%.2f max), "
+				"ran %.2f ms (%.2f max)", pool->getRun(),
+				pool->getWorkers(), pool->getStolen(),
+				pool->getAverageWait(), pool->getLongestWait(),
+				pool->getAverageRun(), pool->getLongestRun());
 	bMotionLog(1, "  %d moods active", _moods.size());
 }
 
@@ -82,15 +184,16 @@ bool System::loadLibrary(const String& name)
 	
 	Library* lib = new Library(name);
 	// register this in the settings
-	Library* oldLib = _activeLib;
-	_activeLib = lib;
+	Context* context = getContext();
+	Library* oldLib = context->activeLib;
+	context->activeLib = lib;
 	if (lib->openLibrary())
 	{
 		registerLibrary(lib);
-		_activeLib = oldLib;
+		context->activeLib = oldLib;
 		return true;
 	}
-	_activeLib = oldLib;
+	context->activeLib = oldLib;
 	delete lib;
 	return false;
 }
@@ -149,39 +252,57 @@ bool System::disableLibrary(Library* lib)
  */
 bool System::removeAllLibraries()
 {
+	Library* activeLib = getActiveLibrary();
 	if (_timerThread)
 		_timerThread->lock();
+	// let the callbacks already handed over finish before their libraries
+	// go, no more are handed over while the timer thread is held
+	_timerMutex.lock();
+	TimerPool* pool = _timerPool;
+	_timerMutex.unlock();
+	if (pool)
+		pool->drain();
 	bMotionLog(1, "cleaning plugins");
 	int i;
 	int size = _plugins.size();
 	for (i = 0; i < size; i++)
 	{
 		Plugin* plugin = _plugins[0];
-		if (plugin->getSource() == _activeLib)
+		if (plugin->getSource() == activeLib)
 			continue;
 		bMotionLog(1, "deleting plugin %s", 
 				(const char*)plugin->getName());
+		unindexPlugin(plugin);
+		_pluginOrder.erase(plugin);
+		_pluginNames.erase(plugin->getSymbol());
 		_plugins.erase(std::find(_plugins.begin(), _plugins.end(), 
 					plugin));
 		delete plugin;
 	}
 	bMotionLog(1, "cleaning timers");
-	size = _timers.size();
+	_timerMutex.lock();
+	std::vector< Timer* > timers;
+	if (_timers)
+		_timers->takeAll(timers);
+	size = timers.size();
 	for (i = 0; i < size; i++)
 	{
-		Timer* timer = _timers[0];
-		if (timer->library() == NULL || timer->library() == _activeLib)
-			continue;
-		_timers.erase(std::find(_timers.begin(), _timers.end(),
-					timer));
-		delete timer;
+		Timer* timer = timers[i];
+		if (timer->library() == NULL || timer->library() == activeLib)
+			_timers->push(timer);
+		else
+		{
+			_timerHandles.erase(timer->getHandle());
+			delete timer;
+		}
 	}
+	_timerMutex.unlock();
 	bMotionLog(1, "cleaning libraries");
 	size = _libraries.size();
 	for (i = 0; i < size; i++)
 	{
 		Library* lib = _libraries[0];
-		if (lib == _activeLib)
+		if (lib == activeLib)
 			continue;
 		bMotionLog(1, "removing library '%s'", 
 				(const char*)lib->getName());
@@ -219,21 +340,58 @@ bool System::disableAllLibraryPlugins(Library* lib)
 }
 
 /*
- * get the last library registered in the system
+ * get the last library registered in the system by this thread
  * @return library pointer
  */
 Library* System::getActiveLibrary()
 {
-	return _activeLib;
+	Context* context = (Context*)_context.get();
+	return context ? context->activeLib : NULL;
 }
 
 /*
- * set the active library
+ * set the active library for this thread
  * @param lib the library
  */
 void System::setActiveLibrary(Library* lib)
 {
-	_activeLib = lib;
+	getContext()->activeLib = lib;
+}
+
+/*
+ * get the state kept for this thread, making it if need be
+ * @return the context
+ */
+System::Context* System::getContext()
+{
+	Context* context = (Context*)_context.get();
+	if (context)
+		return context;
+	context = new Context;
+	context->activeLib = NULL;
+	context->segfault = false;
+	context->dangerous = 0;
+	_contextMutex.lock();
+	_contexts.push_back(context);
+	_contextMutex.unlock();
+	_context.set(context);
+	return context;
+}
+
+/*
+ * forget the state kept for this thread, before it finishes
+ */
+void System::releaseContext()
+{
+	Context* context = (Context*)_context.get();
+	if (!context)
+		return;
+	_context.set(NULL);
+	_contextMutex.lock();
+	_contexts.erase(std::find(_contexts.begin(), _contexts.end(),
+				context));
+	_contextMutex.unlock();
+	delete context;
 }
 
 /*
@@ -243,14 +401,12 @@ void System::setActiveLibrary(Library* lib)
  */
 bool System::addPlugin(Plugin* plugin)
 {
-	int size = _plugins.size();
-	for (int i = 0; i < size; i++)
-	{
-		Plugin* testplugin = _plugins[i];
-		if (testplugin->getName().equals(plugin->getName()))
-			return false;
-	}
+	if (!_pluginNames.insert(plugin->getSymbol(), plugin))
+		return false;
 	_plugins.push_back(plugin);
+	_pluginOrder[plugin] = _nextOrder++;
+	if (plugin->isEnabled())
+		indexPlugin(plugin);
 	return true;
 }
 
@@ -259,16 +415,24 @@ bool System::addPlugin(Plugin* plugin)
  * @param name the name of the plugin
  * @return the plugin requested or NULL if not found
  */
-Plugin* System::getPlugin(const String& name)
+Plugin* System::getPlugin(const char* name)
 {
-	int size = _plugins.size();
-	for (int i = 0; i < size; i++)
-	{
-		Plugin* plugin = _plugins[i];
-		if (plugin->getName().equals(name))
-			return plugin;
-	}
-	return NULL;
+	// names that were never interned can't belong to a plugin
+	Symbol symbol = Symbol::find(name);
+	if (symbol.isEmpty())
+		return NULL;
+	return getPlugin(symbol);
+}
+
+/*
+ * get a plugin by its interned name
+ * @param name the name symbol of the plugin
+ * @return the plugin requested or NULL if not found
+ */
+Plugin* System::getPlugin(const Symbol& name)
+{
+	Plugin** plugin = _pluginNames.find(name);
+	return plugin ? *plugin : NULL;
 }
 
 /*
@@ -297,6 +461,152 @@ bool System::disablePlugin(const String& name)
 	return false;
 }
 
+/*
+ * a plugin has been enabled or disabled, put it into or take it out of the
+ * plugin buckets.
+ * @param plugin the plugin that changed
+ */
+void System::pluginStateChanged(Plugin* plugin)
+{
+	// plugins are enabled before they are added, nothing to do yet
+	if (getPlugin(plugin->getSymbol()) != plugin)
+		return;
+	if (plugin->isEnabled())
+		indexPlugin(plugin);
+	else
+		unindexPlugin(plugin);
+}
+
+/*
+ * get where the bucket for a type, language and event type is kept
+ * @param type the plugin type
+ * @param language the language
+ * @param event the event type
+ * @return the index into _buckets
+ */
+int System::getBucketKey(PluginType type, Language language, EventType event)
+{
+	return (type * LANGUAGE_COUNT + language) * EVENTTYPE_COUNT + event;
+}
+
+/*
+ * get the bucket of enabled plugins for a type, language and event type.
+ * the buckets are made by the constructor, this only looks.
+ * @param type the plugin type
+ * @param language the language, the bucket includes plugins for any language
+ * @param event the event type, only used for event plugins
+ * @return the bucket
+ */
+PluginMatcher* System::getBucket(PluginType type, Language language,
+		EventType event)
+{
+	if (type != Event)
+		event = Unknown;
+	return _buckets[getBucketKey(type, language, event)];
+}
+
+/*
+ * put an enabled plugin into the buckets it belongs in. a plugin for any
+ * language goes into the bucket of every language.
+ * @param plugin the plugin
+ */
+void System::indexPlugin(Plugin* plugin)
+{
+	// admin plugins are looked up by command, not matched
+	if (plugin->getType() == Admin)
+	{
+		indexAdminPlugin((AdminPlugin*)plugin);
+		return;
+	}
+	EventType event = Unknown;
+	if (plugin->getType() == Event)
+		event = ((EventPlugin*)plugin)->getEventType();
+	unsigned long order = _pluginOrder[plugin];
+	Language lang = plugin->getLanguage();
+	for (int i = 0; i < LANGUAGE_COUNT; i++)
+	{
+		if (lang == any || lang == i)
+			getBucket(plugin->getType(), (Language)i, event)->add(
+					plugin, order);
+	}
+}
+
+/*
+ * take a plugin out of all of the buckets
+ * @param plugin the plugin
+ */
+void System::unindexPlugin(Plugin* plugin)
+{
+	if (plugin->getType() == Admin)
+	{
+		unindexAdminPlugin((AdminPlugin*)plugin);
+		return;
+	}
+	EventType event = Unknown;
+	if (plugin->getType() == Event)
+		event = ((EventPlugin*)plugin)->getEventType();
+	Language lang = plugin->getLanguage();
+	for (int i = 0; i < LANGUAGE_COUNT; i++)
+	{
+		if (lang == any || lang == i)
+			getBucket(plugin->getType(), (Language)i, event)->remove(
+					plugin);
+	}
+}
+
+/*
+ * put an enabled admin plugin into the command tables. if another plugin
+ * already has the command the one registered first keeps it.
+ * @param plugin the plugin
+ */
+void System::indexAdminPlugin(AdminPlugin* plugin)
+{
+	unsigned long order = _pluginOrder[plugin];
+	Language lang = plugin->getLanguage();
+	for (int i = 0; i < LANGUAGE_COUNT; i++)
+	{
+		if (lang != any && lang != i)
+			continue;
+		AdminPlugin*& current = _adminCommands[i][plugin->getRegexp()];
+		if (!current || _pluginOrder[current] > order)
+			current = plugin;
+	}
+}
+
+/*
+ * take an admin plugin out of the command tables, handing its commands to
+ * any other enabled plugin with the same command.
+ * @param plugin the plugin
+ */
+void System::unindexAdminPlugin(AdminPlugin* plugin)
+{
+	const String& command = plugin->getRegexp();
+	Language lang = plugin->getLanguage();
+	for (int i = 0; i < LANGUAGE_COUNT; i++)
+	{
+		if (lang != any && lang != i)
+			continue;
+		AdminPlugin** current = _adminCommands[i].find(command);
+		if (!current || *current != plugin)
+			continue;
+		_adminCommands[i].erase(command);
+		int size = _plugins.size();
+		for (int j = 0; j < size; j++)
+		{
+			Plugin* other = _plugins[j];
+			if (other == plugin || other->getType() != Admin ||
+					!other->isEnabled() ||
+					!command.equals(other->getRegexp()))
+				continue;
+			if (other->getLanguage() != any &&
+					other->getLanguage() != i)
+				continue;
+			_adminCommands[i].insert(command, (AdminPlugin*)other);
+			break;
+		}
+	}
+}
+
 /*
  * find a simple plugin that will run for the given text in the given language.
  * this takes the plugin "chance" into consideration.
@@ -304,23 +614,18 @@ bool System::disablePlugin(const String& name)
  * @param language the language for the plugin
  * @return a simple plugin or NUll if none are found
  */
-SimplePlugin* System::findSimplePlugin(const String& text, Language language)
+SimplePlugin* System::findSimplePlugin(const StringRef& text,
+		Language language)
 {
-	int size = _plugins.size();
+	std::vector< Plugin* > matched;
+	getBucket(Simple, language)->match(text, matched);
+	int size = matched.size();
 	for (int i = 0; i < size; i++)
 	{
-		Plugin* plugin = _plugins[i];
-		if (plugin->getType() == Simple)
-		{
-			Language lang = plugin->getLanguage();
-			if (lang != language && lang != any)
-				continue;
-			if (!text.matches(plugin->getRegexp()))
-				continue;
-			if (plugin->getChance() < rand() % 100)
-				continue;
-			return (SimplePlugin*)plugin;
-		}
+		Plugin* plugin = matched[i];
+		if (plugin->getChance() < rand() % 100)
+			continue;
+		return (SimplePlugin*)plugin;
 	}
 	return NULL;
 }
@@ -332,25 +637,19 @@ SimplePlugin* System::findSimplePlugin(const String& text, Language language)
  * @param language the language for the plugin
  * @return a set of complex plugins (empty if none are found)
  */
-std::vector< ComplexPlugin* > System::findComplexPlugins(const String& text,
-		Language language)
+std::vector< ComplexPlugin* > System::findComplexPlugins(
+		const StringRef& text, Language language)
 {
 	std::vector< ComplexPlugin* > answer;
-	int size = _plugins.size();
+	std::vector< Plugin* > matched;
+	getBucket(Complex, language)->match(text, matched);
+	int size = matched.size();
 	for (int i = 0; i < size; i++)
 	{
-		Plugin* plugin = _plugins[i];
-		if (plugin->getType() == Complex)
-		{
-			Language lang = plugin->getLanguage();
-			if (lang != language && lang != any)
-				continue;
-			if (!text.matches(plugin->getRegexp()))
-				continue;
-			if (plugin->getChance() < rand() % 100)
-				continue;
-			answer.push_back((ComplexPlugin*)plugin);
-		}
+		Plugin* plugin = matched[i];
+		if (plugin->getChance() < rand() % 100)
+			continue;
+		answer.push_back((ComplexPlugin*)plugin);
 	}
 	return answer;
 }
@@ -363,27 +662,18 @@ std::vector< ComplexPlugin* > System::findComplexPlugins(const String& text,
  * @return a set of event plugins (empty if none are found)
  */
 std::vector< EventPlugin* > System::findEventPlugins(EventType type, 
-		const String& text, Language language)
+		const StringRef& text, Language language)
 {
 	std::vector< EventPlugin* > answer;
-	int size = _plugins.size();
+	std::vector< Plugin* > matched;
+	getBucket(Event, language, type)->match(text, matched);
+	int size = matched.size();
 	for (int i = 0; i < size; i++)
 	{
-		Plugin* plugin = _plugins[i];
-		if (plugin->getType() == Event)
-		{
-			Language lang = plugin->getLanguage();
-			if (lang != language && lang != any)
-				continue;
-			EventPlugin* test = (EventPlugin*)plugin;
-			if (test->getEventType() != type)
-				continue;
-			if (!text.matches(test->getRegexp()))
-				continue;
-			if (test->getChance() < rand() % 100)
-				continue;
-			answer.push_back(test);
-		}
+		EventPlugin* test = (EventPlugin*)matched[i];
+		if (test->getChance() < rand() % 100)
+			continue;
+		answer.push_back(test);
 	}
 	return answer;
 }
@@ -394,24 +684,12 @@ std::vector< EventPlugin* > System::findEventPlugins(EventType type,
  * @param language the language for the plugin
  * @return an admin plugin or NUll if none are found
  */
-AdminPlugin* System::findAdminPlugin(const String& command, Language language)
+AdminPlugin* System::findAdminPlugin(const StringRef& command,
+		Language language)
 {
-	int size = _plugins.size();
-	for (int i = 0; i < size; i++)
-	{
-		Plugin* plugin = _plugins[i];
-		if (plugin->getType() == Admin)
-		{
-			Language lang = plugin->getLanguage();
-			if (lang != language && lang != any)
-				continue;
-			// not reg exp
-			if (!command.equals(plugin->getRegexp()))
-				continue;
-			return (AdminPlugin*)plugin;
-		}
-	}
-	return NULL;
+	AdminPlugin** plugin = _adminCommands[language].find(
+			command.toString());
+	return plugin ? *plugin : NULL;
 }
 
 /*
@@ -421,25 +699,19 @@ AdminPlugin* System::findAdminPlugin(const String& command, Language language)
  * @param language the language for the plugin
  * @return a set of output plugins (empty if none are found)
  */
-std::vector< OutputPlugin* > System::findOutputPlugins(const String& text,
-		Language language)
+std::vector< OutputPlugin* > System::findOutputPlugins(
+		const StringRef& text, Language language)
 {
 	std::vector< OutputPlugin* > answer;
-	int size = _plugins.size();
+	std::vector< Plugin* > matched;
+	getBucket(Output, language)->match(text, matched);
+	int size = matched.size();
 	for (int i = 0; i < size; i++)
 	{
-		Plugin* plugin = _plugins[i];
-		if (plugin->getType() == Output)
-		{
-			Language lang = plugin->getLanguage();
-			if (lang != language && lang != any)
-				continue;
-			if (!text.matches(plugin->getRegexp()))
-				continue;
-			if (plugin->getChance() < rand() % 100)
-				continue;
-			answer.push_back((OutputPlugin*)plugin);
-		}
+		Plugin* plugin = matched[i];
+		if (plugin->getChance() < rand() % 100)
+			continue;
+		answer.push_back((OutputPlugin*)plugin);
 	}
 	return answer;
 }
@@ -458,34 +730,97 @@ void CheckTimers(void*)
  * @param milli millisecond interval for the timed event.
  * @param callback the callback function for the event.
  * @param param pointer to some parameter that will be used in the callback
- * @return true or false. if false, assume that the timer will never happen.
+ * @param period milliseconds between firings after the first, 0 to only
+ * 	  fire once. a repeating timer fires until it is cancelled.
+ * @return a handle to cancel it with. if 0, assume that the timer will never
+ * 	   happen.
  */
-bool System::addTimer(unsigned long milli, void(*callback)(void*), void* param)
+unsigned long System::addTimer(unsigned long milli, void(*callback)(void*),
+		void* param, unsigned long period)
 {
 	// why are we using gthreads here and not alarm() or ualarm()?
 	// this is because when we launch 3 alarms in sequence, only one
 	// actually makes it through. This is at least true in the tests
 	// that we ran. So for the time being, this will do... we create
-	// a thread if one doesn't exist that polls the active timers and
-	// fires off ones that are ready. If no more are left, the thread
-	// dies and must be restarted when another timer is added.
-	//if (_timerThread != 0)
-	//	g_thread_mutex_lock(&_timerMutex);
-	Timer* timer = new Timer(_activeLib, milli, callback, param);
-	_timers.push_back(timer);
-	//if (_timerThread != 0)
-	//	g_thread_mutex_unlock(&_timerMutex);
-	if (_timers.size() == 1) // if (_timerThread == 0)
+	// a thread the first time a timer is added, which sleeps until the
+	// next timer is due and fires off all the ones that are ready. it
+	// lasts until killTimers().
+	Timer* timer = new Timer(getActiveLibrary(), milli, callback, param,
+			period);
+	_timerMutex.lock();
+	if (_timerStopping)
 	{
+		_timerMutex.unlock();
+		delete timer;
+		return 0;
+	}
+	if (!_timerRunning)
+	{
+		if (bMotionSettings().timers() == Wheel)
+			_timers = new TimerWheel();
+		else
+			_timers = new TimerHeap();
+		_timerPool = new TimerPool();
+		int workers = bMotionSettings().timerWorkers();
+		if (workers > 0 && _timerPool->start(workers) == 0)
+			bMotionLog(1, "timer callbacks will be run on the "
+					"timer thread");
 		bMotionLog(1, "creating new timer thread");
 		_timerThread = new Thread();
 		if (!_timerThread->create(CheckTimers, NULL))
 		{
 			bMotionLog(1, "timers will not be active");
 			delete _timerThread;
-			return false;
+			_timerThread = NULL;
+			delete _timers;
+			_timers = NULL;
+			delete _timerPool;
+			_timerPool = NULL;
+			_timerMutex.unlock();
+			delete timer;
+			return 0;
 		}
+		_timerRunning = true;
 	}
+	// 0 is never a handle, and one still in use is skipped if they have
+	// gone all the way round
+	unsigned long handle;
+	do
+	{
+		handle = ++_nextTimer;
+	} while (handle == 0 || _timerHandles.find(handle) !=
+			_timerHandles.end());
+	timer->setHandle(handle);
+	_timerHandles[handle] = timer;
+	queueTimer(timer);
+	_timerMutex.unlock();
+	return handle;
+}
+
+/*
+ * stop a timer from firing. one that is due but hasn't reached a worker yet
+ * is dropped; a repeating timer that is being fired right now finishes that
+ * go but doesn't fire again.
+ * @param handle the handle addTimer() gave for it
+ * @return true or false. false if there is no such timer, say because it
+ * 	   has already fired.
+ */
+bool System::cancelTimer(unsigned long handle)
+{
+	_timerMutex.lock();
+	std::map< unsigned long, Timer* >::iterator found =
+		_timerHandles.find(handle);
+	if (found == _timerHandles.end())
+	{
+		_timerMutex.unlock();
+		return false;
+	}
+	Timer* timer = found->second;
+	_timerHandles.erase(found);
+	// otherwise it is being fired, and the timer thread gets rid of it
+	if (_timers->remove(timer))
+		delete timer;
+	_timerMutex.unlock();
 	return true;
 }
 
@@ -498,69 +833,143 @@ bool System::killTimers()
 	if (_timerThread == NULL)
 		return true; // dead already... YAY!
 	_timerThread->lock();
-	int size = _timers.size();
+	_timerMutex.lock();
+	_timerStopping = true;
+	std::vector< Timer* > timers;
+	_timers->takeAll(timers);
+	int size = timers.size();
 	for (int i = 0; i < size; i++)
-	{
-		Timer* timer = _timers[i];
-		delete timer;
-	}
-	_timers.clear();
+		delete timers[i];
+	_timerHandles.clear();
+	_timerCondition.broadcast();
+	_timerMutex.unlock();
 	_timerThread->unlock();
-#ifndef WIN32
-	usleep(PAUSE_LENGTH); // give it a chance to close the thread
-#else
-	Sleep(PAUSE_LENGTH);
-#endif
+	// wait for the thread to finish
+	_timerMutex.lock();
+	while (_timerRunning)
+		_timerCondition.wait(_timerMutex);
+	_timerMutex.unlock();
+	// then for the callbacks it handed over, which may still want the lock
+	_timerPool->stop();
+	_timerMutex.lock();
+	_timerStopping = false;
+	delete _timers;
+	_timers = NULL;
+	delete _timerPool;
+	_timerPool = NULL;
+	_timerMutex.unlock();
 	delete _timerThread;
 	_timerThread = NULL;
 	return true;
 }
 
 /*
- * check if the timers need to be fired or not.
+ * the timer thread. sleeps until the next timer is due, then fires off
+ * every timer that is ready.
  */
 void System::checkTimers()
 {
-	while (_timers.size() > 0)
+	_timerMutex.lock();
+	while (!_timerStopping)
 	{
-		int size = _timers.size();
-		for (int i = 0; i < size; i++)
+		TimerTime now = Timer::now();
+		unsigned long wait = 0;
+		if (!_timers->getWait(now, wait))
 		{
-			_timerThread->lock();
-			if ((int)_timers.size() != size)
-				continue;
-			Timer* timer = _timers[i];
-			if (!timer->isReady())
-			{
-				_timerThread->unlock();
-				continue;
-			}
-			Library* oldLib = _activeLib;
-			if (bMotionSystem().startDangerousCode() == 0)
-			{
-				_activeLib = timer->library();
-				timer->dispatch();
-			}
-			_activeLib = oldLib;
-			if (bMotionSystem().endDangerousCode())
-				bMotionLog(1, "timer trigger turned out to be naughty code");
-			_timers.erase(std::find(_timers.begin(),
-						_timers.end(),
-						timer));
-			delete timer;
-			_timerThread->unlock();
-			break;
+			_timerCondition.wait(_timerMutex);
+			continue;
 		}
-#ifndef WIN32
-		// wait half a second
-		usleep(PAUSE_LENGTH);
-#else
-		Sleep(PAUSE_LENGTH);
-#endif
-	};
+		if (wait > 0)
+		{
+			_timerCondition.wait(_timerMutex, wait);
+			continue;
+		}
+
+		// the thread lock comes first. removeAllLibraries() holds it
+		// while it waits for the pool, so nothing more is handed over
+		_timerMutex.unlock();
+		_timerThread->lock();
+		_timerMutex.lock();
+		Timer* ready;
+		while ((ready = _timers->popDue(now)))
+			_timerDue.push_back(ready);
+		_timerMutex.unlock();
+
+		// the pool fires them, and puts them back if they repeat
+		int size = _timerDue.size();
+		for (int i = 0; i < size; i++)
+			_timerPool->submit(_timerDue[i]);
+		_timerDue.clear();
+		_timerThread->unlock();
+		_timerMutex.lock();
+	}
 	bMotionLog(1, "killing off timer thread");
-	delete _timerThread;
-	_timerThread = NULL;
+	_timerRunning = false;
+	_timerCondition.broadcast();
+	_timerMutex.unlock();
+}
+
+/*
+ * fire a timer that is due, then put it back if it repeats and hasn't been
+ * cancelled. called by the TimerPool, on whichever thread it picks.
+ * @param timer the timer, which has been taken out of the queue
+ */
+void System::fireTimer(Timer* timer)
+{
+	// it may have been cancelled while it waited for a worker
+	_timerMutex.lock();
+	bool cancelled = _timerHandles.find(timer->getHandle()) ==
+		_timerHandles.end();
+	_timerMutex.unlock();
+	if (cancelled)
+	{
+		delete timer;
+		return;
+	}
+
+	Context* context = getContext();
+	Library* oldLib = context->activeLib;
+	if (startDangerousCode() == 0)
+	{
+		context->activeLib = timer->library();
+		timer->dispatch();
+	}
+	context->activeLib = oldLib;
+	if (endDangerousCode())
+		bMotionLog(1, "timer trigger turned out to be naughty code");
+
+	_timerMutex.lock();
+	std::map< unsigned long, Timer* >::iterator found =
+		_timerHandles.find(timer->getHandle());
+	cancelled = found == _timerHandles.end();
+	if (!cancelled && timer->getPeriod() > 0)
+	{
+		timer->rearm(Timer::now());
+		queueTimer(timer);
+		_timerMutex.unlock();
+		return;
+	}
+	if (!cancelled)
+		_timerHandles.erase(found);
+	_timerMutex.unlock();
+	delete timer;
+}
+
+/*
+ * put a timer in the queue, waking the timer thread if it is due before
+ * the thread would wake anyway. must be called with the timer lock held.
+ * @param timer the timer
+ */
+void System::queueTimer(Timer* timer)
+{
+	TimerTime now = Timer::now();
+	unsigned long before = 0;
+	bool waiting = _timers->getWait(now, before);
+	_timers->push(timer);
+	unsigned long after = 0;
+	_timers->getWait(now, after);
+	if (!waiting || after < before)
+		_timerCondition.signal();
 }
 
 /*
@@ -568,36 +977,59 @@ void System::checkTimers()
  */
 void segfaultHandler(int /*val*/)
 {
-	bMotionLog(1, "caught segmentation fault signal... trying to recover");
 	bMotionSystem().restoreStack();
 }
 
 /*
- * attempt to restore the stack state
+ * attempt to restore the stack state of the thread that faulted. if it
+ * wasn't in dangerous code the signal is put back to the default, so the
+ * fault happens again and is fatal.
  */
 void System::restoreStack()
 {
-	_segfault = true;
+	Context* context = (Context*)_context.get();
+	if (!context || context->dangerous == 0)
+	{
+		signal(SIGSEGV, SIG_DFL);
 #ifndef WIN32
-	siglongjmp(_stack, 1);
+		signal(SIGBUS, SIG_DFL);
+#endif
+		return;
+	}
+	bMotionLog(1, "caught segmentation fault signal... trying to recover");
+	context->segfault = true;
+#ifndef WIN32
+	siglongjmp(context->stack, 1);
 #else
-	longjmp(_stack, 1);
+	longjmp(context->stack, 1);
 #endif
 }
 
 /*
- * set the tracking in case of SEGV
+ * set the tracking in case of SEGV, for this thread. the handlers stay set
+ * while any thread is in dangerous code.
  * @return stack set
  */
 int System::startDangerousCode()
 {
-	_segfault = false;
-	signal(SIGSEGV, segfaultHandler);
+	Context* context = getContext();
+	context->segfault = false;
+	if (context->dangerous++ == 0)
+	{
+		_contextMutex.lock();
+		if (_dangerous++ == 0)
+		{
+			signal(SIGSEGV, segfaultHandler);
+#ifndef WIN32
+			signal(SIGBUS, segfaultHandler);
+#endif
+		}
+		_contextMutex.unlock();
+	}
 #ifndef WIN32
-	signal(SIGBUS, segfaultHandler);
-	return sigsetjmp(_stack, 1);
+	return sigsetjmp(context->stack, 1);
 #else
-	return setjmp(_stack);
+	return setjmp(context->stack);
 #endif
 }
 
@@ -607,11 +1039,20 @@ int System::startDangerousCode()
  */
 bool System::endDangerousCode()
 {
-	signal(SIGSEGV, SIG_DFL);
+	Context* context = getContext();
+	if (--context->dangerous == 0)
+	{
+		_contextMutex.lock();
+		if (--_dangerous == 0)
+		{
+			signal(SIGSEGV, SIG_DFL);
 #ifndef WIN32
-	signal(SIGBUS, SIG_DFL);
+			signal(SIGBUS, SIG_DFL);
 #endif
-	return _segfault;
+		}
+		_contextMutex.unlock();
+	}
+	return context->segfault;
 }
 
 /*
@@ -621,22 +1062,64 @@ bool System::endDangerousCode()
  */
 bool System::abstractRegister(const String& name)
 {
-	Abstract* abstract = NULL;
-	if (_abstracts[name] != NULL)
-		abstract = _abstracts[name];
-	else
+	Symbol symbol(name);
+	Abstract* existing = findAbstract(symbol);
+	Abstract* abstract = existing;
+	if (!existing)
 		abstract = new Abstract(name);
 	bMotionLog(1, "creating abstract '%s'", (const char*)name);
 	if (!abstract->create())
 	{
-		if (_abstracts[name] == NULL)
+		if (!existing)
 			delete abstract;
 		return false;
 	}
-	_abstracts[name] = abstract;
+	if (!existing)
+	{
+		_abstractMutex.lock();
+		_abstracts.insert(symbol, abstract);
+		_abstractMutex.unlock();
+	}
+	// it'll be wanted soon, load it while nobody is waiting
+	if (!abstract->isLoaded())
+		_loader.request(abstract);
 	return true;
 }
 
+/*
+ * Find an abstract by name
+ * @param name the name of the abstract
+ * @return the abstract, NULL if there isn't one by that name
+ */
+Abstract* System::findAbstract(const Symbol& name)
+{
+	_abstractMutex.lock();
+	Abstract** abstract = _abstracts.find(name);
+	Abstract* found = abstract ? *abstract : NULL;
+	_abstractMutex.unlock();
+	return found;
+}
+
+/*
+ * get every abstract, for going through them without holding the lock
+ * @return the abstracts. they are only deleted with the System.
+ */
+std::vector< Abstract* > System::getAbstracts()
+{
+	std::vector< Abstract* > abstracts;
+	_abstractMutex.lock();
+	abstracts.reserve(_abstracts.size());
+	HashMap< Symbol, Abstract*, hashsym, eqsym >::iterator iter;
+	iter = _abstracts.begin();
+	while (iter != _abstracts.end())
+	{
+		abstracts.push_back(iter->second);
+		++iter;
+	}
+	_abstractMutex.unlock();
+	return abstracts;
+}
+
 /*
  * Batch add to an abstract
  * @param name the name of the abstract to which to add.
@@ -645,41 +1128,178 @@ bool System::abstractRegister(const String& name)
  */
 bool System::abstractAddValue(const String& name, const String& value)
 {	
-	if (_abstracts[name] == NULL)
+	Abstract* abstract = findAbstract(Symbol::find(name));
+	if (!abstract)
+		return false;
+	abstract->addValue(value);
+	_cache.resize(abstract, abstract->getSize());
+	return true;
+}
+
+/*
+ * Add an array of values to an abstract in one go
+ * @param name the name of the abstract to which to add.
+ * @param values the values to add
+ * @param count the number of values
+ * @return true or false. false if there is no such abstract.
+ */
+bool System::abstractAddValues(const String& name, const char** values,
+		int count)
+{
+	Abstract* abstract = findAbstract(Symbol::find(name));
+	if (!abstract)
 		return false;
-	_abstracts[name]->addValue(value);
+	abstract->addValues(values, count);
+	_cache.resize(abstract, abstract->getSize());
 	return true;
 }
 
 /*
- * Get a value from the named abstract
+ * Get a value from the named abstract. an abstract that isn't in memory is
+ * loaded on the loader thread, and the caller only waits a little while
+ * for it.
  * @param name the name of the abstract to which to add.
+ * @param loading set to true if the abstract wasn't loaded in time
  * @return some value, empty if not there
  */
-String System::abstractGetValue(const String& name)
+String System::abstractGetValue(const String& name, bool& loading)
 {
-	if (_abstracts[name] == NULL)
-		return String();
-	return _abstracts[name]->getRandomValue();
+	loading = false;
+	String value;
+	Abstract* abstract = findAbstract(Symbol::find(name));
+	if (!abstract)
+		return value;
+	if (abstract->getRandomValue(value, false))
+	{
+		_cache.touch(abstract, true);
+		return value;
+	}
+	bool loaded = abstract->isLoaded();
+	_cache.touch(abstract, loaded);
+	if (loaded)
+		return value;
+	// it may have been turned away as a prefetch just before it was asked
+	// for, in which case it is loaded next time
+	if (!_loader.waitFor(abstract, BMOTION_ABSTRACT_WAIT) ||
+			(!abstract->getRandomValue(value, false) &&
+			!abstract->isLoaded()))
+		loading = true;
+	return value;
 }
 
 /*
- * Garbage collect the abstracts
+ * Garbage collect the abstracts. ones loaded for another language are
+ * unloaded, then the least useful go until the rest fit in the budget.
  * @return true or false
  */
 bool System::abstractGarbageCollect()
 {
 	bMotionLog(1, "Garbage collecting abstracts...");
 	bool happened = false;
-	std::map< String, Abstract*, ltstr >::iterator iter;
-	iter = _abstracts.begin();
-	while (iter != _abstracts.end())
+	std::vector< Abstract* > abstracts = getAbstracts();
+	int size = abstracts.size();
+	for (int i = 0; i < size; i++)
 	{
-		if (iter->second->garbageCollect())
+		if (abstracts[i]->garbageCollect())
 			happened = true;
-		iter++;
+		// catches up with anything the cache missed
+		_cache.resize(abstracts[i], abstracts[i]->getSize());
 	}
-	return happened;
+	unsigned long resident = _cache.getResident();
+	abstractTrim(NULL);
+	return happened || _cache.getResident() < resident;
+}
+
+/*
+ * unload abstracts until the loaded ones fit in the budget set by
+ * abstractBudget in the settings
+ * @param keep an abstract that has to stay loaded, NULL if none
+ */
+void System::abstractTrim(Abstract* keep)
+{
+	unsigned long budget = bMotionSettings().abstractBudget() * 1024UL;
+	std::vector< Abstract* > victims = _cache.getVictims(budget, keep);
+	int size = victims.size();
+	for (int i = 0; i < size; i++)
+	{
+		victims[i]->unload();
+		_cache.resize(victims[i], 0);
+	}
+}
+
+/*
+ * decide whether an abstract that may be wanted soon should be loaded now
+ * @param abstract the abstract
+ * @return true if the cache has room for it, or it is worth making room
+ */
+bool System::abstractAdmit(Abstract* abstract)
+{
+	return _cache.admit(abstract,
+			bMotionSettings().abstractBudget() * 1024UL);
+}
+
+/*
+ * called once an abstract has been loaded, to count it against the budget
+ * @param abstract the abstract
+ */
+void System::abstractLoaded(Abstract* abstract)
+{
+	_cache.resize(abstract, abstract->getSize());
+	abstractTrim(abstract);
+}
+
+/*
+ * Write out the changes made to the abstracts, all together
+ * @return true or false. false if any of them couldn't be written.
+ */
+bool System::abstractFlush()
+{
+	bool success = true;
+	std::vector< Abstract* > abstracts = getAbstracts();
+	int size = abstracts.size();
+	for (int i = 0; i < size; i++)
+	{
+		if (!abstracts[i]->flush())
+			success = false;
+	}
+	return success;
+}
+
+/*
+ * get the compiled abstracts for a language. the pack is looked for the
+ * first time it is asked for and kept for good, since abstracts loaded from
+ * it look straight into it.
+ * @param language the language
+ * @return the pack, NULL if there isn't a usable one
+ */
+AbstractPack* System::getAbstractPack(Language language)
+{
+	if (language < 0 || language >= LANGUAGE_COUNT)
+		return NULL;
+	// abstracts are loaded on the loader thread as well as this one
+	_packMutex.lock();
+	if (_packTried[language])
+	{
+		_packMutex.unlock();
+		return _packs[language];
+	}
+	_packTried[language] = true;
+	String filename = bMotionSettings().abstractPath();
+#ifndef WIN32
+	filename.concat("/");
+#else
+	filename.concat("\\");
+#endif
+	filename.concat(Settings::getStringFromLanguage(language));
+	filename.concat(".pack");
+	AbstractPack* pack = new AbstractPack();
+	if (pack->open(filename))
+		_packs[language] = pack;
+	else
+		delete pack;
+	AbstractPack* result = _packs[language];
+	_packMutex.unlock();
+	return result;
 }
 
 /*
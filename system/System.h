@@ -11,14 +11,20 @@
 #include <AdminPlugin.h>
 #include <OutputPlugin.h>
 #include <Timer.h>
+#include <TimerQueue.h>
+#include <TimerPool.h>
 #include <setjmp.h>
 #include <Abstract.h>
 #include <bString.h>
 #include <Mood.h>
 #include <Thread.h>
-
-// lapse for waiting in the timer thread
-#define PAUSE_LENGTH (500)
+#include <PluginMatcher.h>
+#include <HashMap.h>
+#include <Symbol.h>
+#include <StringRef.h>
+#include <AbstractPack.h>
+#include <AbstractLoader.h>
+#include <AbstractCache.h>
 
 class Plugin;
 
@@ -40,30 +46,38 @@ public:
 	bool disableLibrary(Library* lib);
 	bool disableAllLibraryPlugins(Library* lib);
 
-	// hmmm
+	// hmmm. each thread has its own
 	Library* getActiveLibrary();
 	void setActiveLibrary(Library* lib);
+	void releaseContext();
 
 	// plugins
-	Plugin* getPlugin(const String& name);
+	Plugin* getPlugin(const char* name);
+	Plugin* getPlugin(const Symbol& name);
 	bool addPlugin(Plugin* plugin);
 	bool enablePlugin(const String& name);
 	bool disablePlugin(const String& name);
+	void pluginStateChanged(Plugin* plugin);
 
 	// plugin type specific methods
-	SimplePlugin* findSimplePlugin(const String& text, Language language);
-	std::vector< ComplexPlugin* > findComplexPlugins(const String& text,
+	SimplePlugin* findSimplePlugin(const StringRef& text,
+			Language language);
+	std::vector< ComplexPlugin* > findComplexPlugins(const StringRef& text,
 			Language language);
 	std::vector< EventPlugin* > findEventPlugins(EventType type,
-			const String& text, Language language);
-	AdminPlugin* findAdminPlugin(const String& text, Language language);
-	std::vector< OutputPlugin* > findOutputPlugins(const String& text,
+			const StringRef& text, Language language);
+	AdminPlugin* findAdminPlugin(const StringRef& command,
+			Language language);
+	std::vector< OutputPlugin* > findOutputPlugins(const StringRef& text,
 			Language language);
 
 	// Timers
-	bool addTimer(unsigned long milli, void(*callback)(void*), void* param);
+	unsigned long addTimer(unsigned long milli, void(*callback)(void*),
+			void* param, unsigned long period = 0);
+	bool cancelTimer(unsigned long handle);
 	bool killTimers();
 	void checkTimers();
+	void fireTimer(Timer* timer);
 
 	// handling
 	void restoreStack();
@@ -72,9 +86,16 @@ public:
 
 	// abstracts
 	bool abstractRegister(const String& name);
+	Abstract* findAbstract(const Symbol& name);
 	bool abstractAddValue(const String& name, const String& value);
-	String abstractGetValue(const String& name);
+	bool abstractAddValues(const String& name, const char** values,
+			int count);
+	String abstractGetValue(const String& name, bool& loading);
 	bool abstractGarbageCollect();
+	bool abstractFlush();
+	bool abstractAdmit(Abstract* abstract);
+	void abstractLoaded(Abstract* abstract);
+	AbstractPack* getAbstractPack(Language language);
 
 	// moods
 	bool moodDrift();
@@ -88,26 +109,89 @@ private:
 	// collections
 	std::vector< Library* > _libraries;
 	std::vector< Plugin* > _plugins;
-	std::vector< Timer* > _timers;
-	std::map< String, Abstract*, ltstr> _abstracts;
+	HashMap< Symbol, Plugin*, hashsym, eqsym > _pluginNames;
+	// made when the timer thread starts, see the timers setting
+	TimerQueue* _timers;
+	HashMap< Symbol, Abstract*, hashsym, eqsym > _abstracts;
+	// guards _abstracts, which the loader thread looks in too
+	Mutex _abstractMutex;
+	// decides which abstracts stay loaded
+	AbstractCache _cache;
+	AbstractLoader _loader;
+	// compiled abstracts by language, opened when first needed
+	AbstractPack* _packs[LANGUAGE_COUNT];
+	bool _packTried[LANGUAGE_COUNT];
+	Mutex _packMutex;
 	std::vector< Mood* > _moods;
-
-	// active lib
-	Library* _activeLib;
-
-	// timer thread
+	// enabled plugins by type, language and event type. they are all made
+	// up front so that finding one never changes the table, plugins are
+	// matched on more than one thread. only event plugins have a bucket per
+	// event type, the rest are NULL.
+	PluginMatcher* _buckets[PLUGINTYPE_COUNT * LANGUAGE_COUNT *
+		EVENTTYPE_COUNT];
+	std::map< const Plugin*, unsigned long > _pluginOrder;
+	unsigned long _nextOrder;
+	// enabled admin plugins by language and command
+	HashMap< String, AdminPlugin*, hashstr, eqstr >
+		_adminCommands[LANGUAGE_COUNT];
+
+	std::vector< Abstract* > getAbstracts();
+	void abstractTrim(Abstract* keep);
+
+	// timer thread. it sleeps on _timerCondition until the next timer is
+	// due, _timerMutex guards the timers and the flags. due timers are
+	// handed to _timerPool with the thread's own lock held, take that one
+	// first.
 	Thread* _timerThread;
-
-	// stack
+	Mutex _timerMutex;
+	Condition _timerCondition;
+	bool _timerRunning;
+	bool _timerStopping;
+	// the timers by handle, whether they are waiting in _timers or being
+	// fired. one being fired that isn't here has been cancelled.
+	std::map< unsigned long, Timer* > _timerHandles;
+	unsigned long _nextTimer;
+	// the timers being handed to _timerPool, kept to save allocating it
+	// every time
+	std::vector< Timer* > _timerDue;
+	// runs the callbacks, made with _timers
+	TimerPool* _timerPool;
+
+	// what a thread is doing, see getContext()
+	struct Context
+	{
+		// active lib
+		Library* activeLib;
+		// stack
 #ifndef WIN32
-	sigjmp_buf _stack;
+		sigjmp_buf stack;
 #else
-	jmp_buf _stack;
+		jmp_buf stack;
 #endif
-	bool _segfault;
+		bool segfault;
+		// how many startDangerousCode() calls haven't been ended
+		int dangerous;
+	};
+	ThreadLocal _context;
+	std::vector< Context* > _contexts;
+	// guards _contexts and _dangerous
+	Mutex _contextMutex;
+	// threads in dangerous code, the signal handlers are set while there
+	// are any
+	int _dangerous;
+	Context* getContext();
 
 	// internal functions
 	bool registerLibrary(Library* lib);
+	void queueTimer(Timer* timer);
+	static int getBucketKey(PluginType type, Language language,
+			EventType event);
+	PluginMatcher* getBucket(PluginType type, Language language,
+			EventType event = Unknown);
+	void indexPlugin(Plugin* plugin);
+	void unindexPlugin(Plugin* plugin);
+	void indexAdminPlugin(AdminPlugin* plugin);
+	void unindexAdminPlugin(AdminPlugin* plugin);
 
 };
 
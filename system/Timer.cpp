@@ -1,5 +1,9 @@
 #include <Timer.h>
-#include <math.h>
+#ifndef WIN32
+#include <time.h>
+#else
+#include <windows.h>
+#endif
 
 /*
  * Timer constructor. creates a new timer that starts now.
@@ -7,15 +11,22 @@
  * @param interval milliseconds until it's time to fire.
  * @param callback the callback to fire after milliseconds
  * @param param a parameter pointer to use in callback.
+ * @param period milliseconds between firings after the first, 0 to only
+ * 	  fire once.
  */
 Timer::Timer(Library* lib, unsigned long interval, void(*callback)(void*),
-		void* param)
+		void* param, unsigned long period)
 : _library(lib)
-, _interval(interval)
+, _deadline(now() + (TimerTime)interval * 1000000)
+, _period(period)
+, _handle(0)
 , _callback(callback)
 , _param(param)
+, _prev(NULL)
+, _next(NULL)
+, _slot(-1)
 {
-	time(&_start);	
+
 }
 
 /*
@@ -32,12 +43,53 @@ Timer::~Timer()
  */
 bool Timer::isReady() const
 {
-	time_t end;
-	time(&end);
-	double diff = difftime(end, _start) * 1000;
-	if (_interval <= (unsigned long)floor(diff))
-		return true;
-	return false;
+	return isReady(now());
+}
+
+/*
+ * check if the timer is ready to fire at a given time
+ * @param now the time, from now()
+ * @return true if it's ready, false if it's not.
+ */
+bool Timer::isReady(TimerTime now) const
+{
+	return now >= _deadline;
+}
+
+/*
+ * get the time the timer fires at
+ * @return the time, see now()
+ */
+TimerTime Timer::getDeadline() const
+{
+	return _deadline;
+}
+
+/*
+ * get how often the timer fires
+ * @return milliseconds between firings, 0 if it only fires once
+ */
+unsigned long Timer::getPeriod() const
+{
+	return _period;
+}
+
+/*
+ * get the handle the timer was given when it was added
+ * @return the handle, 0 if it has none
+ */
+unsigned long Timer::getHandle() const
+{
+	return _handle;
+}
+
+/*
+ * give the timer the handle it can be cancelled with
+ * @param handle the handle
+ */
+void Timer::setHandle(unsigned long handle)
+{
+	_handle = handle;
 }
 
 /*
@@ -58,3 +110,43 @@ void Timer::dispatch()
 		_callback(_param);
 }
 
+/*
+ * move a repeating timer on to the next time it fires. if it has fallen a
+ * whole period behind the ones it missed are skipped, rather than fired
+ * all at once.
+ * @param now the time, from now()
+ */
+void Timer::rearm(TimerTime now)
+{
+	TimerTime period = (TimerTime)_period * 1000000;
+	_deadline += period;
+	if (_deadline <= now)
+		_deadline = now + period;
+}
+
+/*
+ * get the time on a clock that only ever goes forward at a steady rate, so
+ * that changing the system clock doesn't upset the timers. it only means
+ * anything compared with another time from now().
+ * @return nanoseconds since some fixed point
+ */
+TimerTime Timer::now()
+{
+#ifndef WIN32
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (TimerTime)now.tv_sec * 1000000000 + now.tv_nsec;
+#else
+	static LARGE_INTEGER frequency;
+	if (frequency.QuadPart == 0)
+		QueryPerformanceFrequency(&frequency);
+	LARGE_INTEGER count;
+	QueryPerformanceCounter(&count);
+	// in two parts so that the multiplication can't overflow
+	TimerTime seconds = count.QuadPart / frequency.QuadPart;
+	TimerTime rest = count.QuadPart % frequency.QuadPart;
+	return seconds * 1000000000 + rest * 1000000000 /
+		frequency.QuadPart;
+#endif
+}
+
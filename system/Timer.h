@@ -1,9 +1,15 @@
 #ifndef BMTIMER_H
 #define BMTIMER_H
 
-#include <time.h>
 #include <Library.h>
 
+// a time in nanoseconds, see Timer::now()
+#ifndef WIN32
+typedef unsigned long long TimerTime;
+#else
+typedef unsigned __int64 TimerTime;
+#endif
+
 /*
  * timer wrapper class. the timer mechanism is in System.
  */
@@ -11,23 +17,44 @@ class Timer
 {
 public:
 	Timer(Library* lib, unsigned long interval, void(*callback)(void*), 
-			void* param);
+			void* param, unsigned long period = 0);
 	virtual ~Timer();
 
 	// information
 	bool isReady() const;
+	bool isReady(TimerTime now) const;
+	TimerTime getDeadline() const;
+	unsigned long getPeriod() const;
+	unsigned long getHandle() const;
 	Library* library();
 
+	// handle
+	void setHandle(unsigned long handle);
+
 	// execution
 	void dispatch();
+	void rearm(TimerTime now);
+
+	// clock
+	static TimerTime now();
 	
 private:
 	Library* _library;
-	unsigned long _interval;
-	time_t _start;
+	// when it is time to fire, see now()
+	TimerTime _deadline;
+	// milliseconds between firings, 0 if it only fires once
+	unsigned long _period;
+	// what System knows it by, 0 if it has not been given one
+	unsigned long _handle;
 	void (*_callback)(void*);
 	void* _param;
+
+	// where the TimerQueue holding it keeps it
+	Timer* _prev;
+	Timer* _next;
+	int _slot;
+	friend class TimerHeap;
+	friend class TimerWheel;
 };
 
 #endif
-
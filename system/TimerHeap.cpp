@@ -0,0 +1,202 @@
+#include <TimerHeap.h>
+
+/*
+ * Constructor
+ */
+TimerHeap::TimerHeap()
+: _sequence(0)
+{
+
+}
+
+/*
+ * Destructor. The timers still in the heap belong to whoever put them in.
+ */
+TimerHeap::~TimerHeap()
+{
+
+}
+
+/*
+ * add a timer
+ * @param timer the timer
+ */
+void TimerHeap::push(Timer* timer)
+{
+	Entry entry;
+	entry.timer = timer;
+	entry.deadline = timer->getDeadline();
+	entry.sequence = _sequence++;
+	_entries.push_back(entry);
+	timer->_slot = _entries.size() - 1;
+	siftUp(_entries.size() - 1);
+}
+
+/*
+ * take a timer out before it fires
+ * @param timer the timer
+ * @return true if it was in the heap
+ */
+bool TimerHeap::remove(Timer* timer)
+{
+	int position = timer->_slot;
+	if (position < 0 || position >= (int)_entries.size() ||
+			_entries[position].timer != timer)
+		return false;
+	erase(position);
+	return true;
+}
+
+/*
+ * take out the timer that fires first, if it is due
+ * @param now the time, see Timer::now()
+ * @return the timer, NULL if none are due
+ */
+Timer* TimerHeap::popDue(TimerTime now)
+{
+	if (_entries.empty() || now < _entries[0].deadline)
+		return NULL;
+	Timer* timer = _entries[0].timer;
+	erase(0);
+	return timer;
+}
+
+/*
+ * take out all of the timers, in no particular order
+ * @param timers the timers are added to this
+ */
+void TimerHeap::takeAll(std::vector< Timer* >& timers)
+{
+	int size = _entries.size();
+	timers.reserve(timers.size() + size);
+	for (int i = 0; i < size; i++)
+	{
+		_entries[i].timer->_slot = -1;
+		timers.push_back(_entries[i].timer);
+	}
+	_entries.clear();
+}
+
+/*
+ * find out how long until the first timer is due
+ * @param now the time, see Timer::now()
+ * @param milli set to the milliseconds to wait, 0 if one is due already
+ * @return false if there are no timers
+ */
+bool TimerHeap::getWait(TimerTime now, unsigned long& milli)
+{
+	if (_entries.empty())
+		return false;
+	TimerTime deadline = _entries[0].deadline;
+	milli = 0;
+	if (now < deadline)
+		milli = (unsigned long)((deadline - now + 999999) / 1000000);
+	return true;
+}
+
+/*
+ * get the number of timers
+ * @return timer count
+ */
+int TimerHeap::size() const
+{
+	return _entries.size();
+}
+
+/*
+ * check if there are no timers
+ * @return true or false
+ */
+bool TimerHeap::empty() const
+{
+	return _entries.empty();
+}
+
+/*
+ * compare two entries
+ * @param a one entry
+ * @param b another entry
+ * @return true if a fires before b
+ */
+bool TimerHeap::earlier(const Entry& a, const Entry& b)
+{
+	if (a.deadline != b.deadline)
+		return a.deadline < b.deadline;
+	return (long)(a.sequence - b.sequence) < 0;
+}
+
+/*
+ * put an entry at a position in the heap
+ * @param entry the entry
+ * @param position where to put it
+ */
+void TimerHeap::place(const Entry& entry, int position)
+{
+	_entries[position] = entry;
+	entry.timer->_slot = position;
+}
+
+/*
+ * move an entry up the heap until its parent fires before it
+ * @param position where the entry is
+ */
+void TimerHeap::siftUp(int position)
+{
+	Entry entry = _entries[position];
+	while (position > 0)
+	{
+		int parent = (position - 1) / 2;
+		if (!earlier(entry, _entries[parent]))
+			break;
+		place(_entries[parent], position);
+		position = parent;
+	}
+	place(entry, position);
+}
+
+/*
+ * move an entry down the heap until it fires before its children
+ * @param position where the entry is
+ */
+void TimerHeap::siftDown(int position)
+{
+	int size = _entries.size();
+	Entry entry = _entries[position];
+	for (;;)
+	{
+		int child = position * 2 + 1;
+		if (child >= size)
+			break;
+		if (child + 1 < size && earlier(_entries[child + 1],
+					_entries[child]))
+			child++;
+		if (!earlier(_entries[child], entry))
+			break;
+		place(_entries[child], position);
+		position = child;
+	}
+	place(entry, position);
+}
+
+/*
+ * take the entry at a position out of the heap
+ * @param position where the entry is
+ */
+void TimerHeap::erase(int position)
+{
+	_entries[position].timer->_slot = -1;
+	int last = _entries.size() - 1;
+	if (position != last)
+	{
+		Entry moved = _entries[last];
+		_entries.pop_back();
+		place(moved, position);
+		if (position > 0 && earlier(moved, _entries[(position - 1) / 2]))
+			siftUp(position);
+		else
+			siftDown(position);
+	}
+	else
+		_entries.pop_back();
+}
+
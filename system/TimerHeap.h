@@ -0,0 +1,49 @@
+#ifndef TIMERHEAP_H
+#define TIMERHEAP_H
+
+#include <vector>
+#include <TimerQueue.h>
+
+/*
+ * The pending timers, kept in a binary min-heap by the time they fire so
+ * that the next one is always at the top. Timers that fire at the same
+ * time come out in the order they went in. Adding, removing and taking the
+ * next timer are O(log n).
+ */
+class TimerHeap : public TimerQueue
+{
+public:
+	TimerHeap();
+	virtual ~TimerHeap();
+
+	// use
+	void push(Timer* timer);
+	bool remove(Timer* timer);
+	Timer* popDue(TimerTime now);
+	void takeAll(std::vector< Timer* >& timers);
+
+	// information
+	bool getWait(TimerTime now, unsigned long& milli);
+	int size() const;
+	bool empty() const;
+
+private:
+	struct Entry
+	{
+		Timer* timer;
+		TimerTime deadline;
+		// order the timer was pushed in
+		unsigned long sequence;
+	};
+
+	static bool earlier(const Entry& a, const Entry& b);
+	void place(const Entry& entry, int position);
+	void siftUp(int position);
+	void siftDown(int position);
+	void erase(int position);
+
+	std::vector< Entry > _entries;
+	unsigned long _sequence;
+};
+
+#endif
@@ -0,0 +1,343 @@
+#include <TimerPool.h>
+#include <bMotion.h>
+#include <Output.h>
+
+/*
+ * Constructor. There are no workers until start() is called.
+ */
+TimerPool::TimerPool()
+: _busy(0)
+, _next(0)
+, _alive(0)
+, _stopping(false)
+, _run(0)
+, _stolen(0)
+, _waited(0)
+, _longestWait(0)
+, _ran(0)
+, _longestRun(0)
+{
+
+}
+
+/*
+ * Destructor. Stops the workers, once they have finished what they have.
+ */
+TimerPool::~TimerPool()
+{
+	stop();
+}
+
+/*
+ * Internal callback for the worker threads.
+ * @param worker the Worker
+ */
+void TimerPool::RunWorker(void* worker)
+{
+	((Worker*)worker)->pool->run((Worker*)worker);
+}
+
+/*
+ * start the workers
+ * @param workers how many to start, at most TIMERPOOL_MAX_WORKERS
+ * @return the number started. if 0 the callbacks are run by submit().
+ */
+int TimerPool::start(int workers)
+{
+	if (workers > TIMERPOOL_MAX_WORKERS)
+		workers = TIMERPOOL_MAX_WORKERS;
+	_mutex.lock();
+	for (int i = 0; i < workers; i++)
+	{
+		Worker* worker = new Worker;
+		worker->pool = this;
+		worker->index = _workers.size();
+		worker->thread = new Thread();
+		worker->current = NULL;
+		// in the list first, the thread looks at it
+		_workers.push_back(worker);
+		if (!worker->thread->create(RunWorker, worker))
+		{
+			bMotionLog(1, "could not start timer worker %d",
+					worker->index);
+			_workers.pop_back();
+			delete worker->thread;
+			delete worker;
+			break;
+		}
+		_alive++;
+	}
+	int started = _workers.size();
+	_mutex.unlock();
+	return started;
+}
+
+/*
+ * hand over a timer that is due. its callback is run after any others from
+ * the same library that were handed in before it.
+ * @param timer the timer
+ */
+void TimerPool::submit(Timer* timer)
+{
+	_mutex.lock();
+	if (_workers.empty())
+	{
+		_run++;
+		_mutex.unlock();
+		TimerTime begin = Timer::now();
+		bMotionSystem().fireTimer(timer);
+		TimerTime taken = Timer::now() - begin;
+		_mutex.lock();
+		_ran += taken;
+		if (taken > _longestRun)
+			_longestRun = taken;
+		_mutex.unlock();
+		return;
+	}
+	Task task;
+	task.timer = timer;
+	task.submitted = Timer::now();
+	Lane* lane;
+	std::map< Library*, Lane* >::iterator found =
+		_lanes.find(timer->library());
+	if (found != _lanes.end())
+		lane = found->second;
+	else
+	{
+		lane = new Lane;
+		lane->library = timer->library();
+		lane->busy = false;
+		lane->home = _next;
+		_next = (_next + 1) % _workers.size();
+		_lanes[lane->library] = lane;
+	}
+	lane->tasks.push_back(task);
+	// otherwise it is queued or being run already, and will be seen to
+	if (!lane->busy)
+	{
+		lane->busy = true;
+		_busy++;
+		_workers[lane->home]->ready.push_back(lane);
+		_work.signal();
+	}
+	_mutex.unlock();
+}
+
+/*
+ * wait for every callback handed in so far to be run. on a worker the
+ * lane it is running is left alone, it can't finish until this returns.
+ */
+void TimerPool::drain()
+{
+	Worker* self = (Worker*)_self.get();
+	_mutex.lock();
+	int mine = self && self->current ? 1 : 0;
+	while (_busy > mine)
+		_idle.wait(_mutex);
+	_mutex.unlock();
+}
+
+/*
+ * stop the workers, once every callback handed in has been run
+ */
+void TimerPool::stop()
+{
+	_mutex.lock();
+	_stopping = true;
+	_work.broadcast();
+	while (_alive > 0)
+		_idle.wait(_mutex);
+	std::vector< Worker* > workers;
+	workers.swap(_workers);
+	std::map< Library*, Lane* > lanes;
+	lanes.swap(_lanes);
+	_stopping = false;
+	_mutex.unlock();
+	int size = workers.size();
+	for (int i = 0; i < size; i++)
+	{
+		delete workers[i]->thread;
+		delete workers[i];
+	}
+	std::map< Library*, Lane* >::iterator iter = lanes.begin();
+	while (iter != lanes.end())
+	{
+		delete iter->second;
+		++iter;
+	}
+}
+
+/*
+ * get the number of worker threads
+ * @return the number, 0 if callbacks are run as they are handed in
+ */
+int TimerPool::getWorkers()
+{
+	_mutex.lock();
+	int workers = _workers.size();
+	_mutex.unlock();
+	return workers;
+}
+
+/*
+ * get the number of callbacks run
+ * @return callback count
+ */
+unsigned long TimerPool::getRun()
+{
+	_mutex.lock();
+	unsigned long run = _run;
+	_mutex.unlock();
+	return run;
+}
+
+/*
+ * get the number of times a worker took a lane queued on another
+ * @return steal count
+ */
+unsigned long TimerPool::getStolen()
+{
+	_mutex.lock();
+	unsigned long stolen = _stolen;
+	_mutex.unlock();
+	return stolen;
+}
+
+/*
+ * get how long callbacks wait between being handed in and being run
+ * @return the average in milliseconds
+ */
+double TimerPool::getAverageWait()
+{
+	_mutex.lock();
+	double wait = _run ? (double)_waited / _run / 1000000 : 0.0;
+	_mutex.unlock();
+	return wait;
+}
+
+/*
+ * get the longest a callback has waited to be run
+ * @return milliseconds
+ */
+double TimerPool::getLongestWait()
+{
+	_mutex.lock();
+	double wait = (double)_longestWait / 1000000;
+	_mutex.unlock();
+	return wait;
+}
+
+/*
+ * get how long callbacks take to run
+ * @return the average in milliseconds
+ */
+double TimerPool::getAverageRun()
+{
+	_mutex.lock();
+	double ran = _run ? (double)_ran / _run / 1000000 : 0.0;
+	_mutex.unlock();
+	return ran;
+}
+
+/*
+ * get the longest a callback has taken to run
+ * @return milliseconds
+ */
+double TimerPool::getLongestRun()
+{
+	_mutex.lock();
+	double ran = (double)_longestRun / 1000000;
+	_mutex.unlock();
+	return ran;
+}
+
+/*
+ * find a worker a lane to run, from its own queue or failing that from the
+ * back of another's. must be called with the lock held.
+ * @param worker the worker
+ * @return the lane, NULL if there are none ready
+ */
+TimerPool::Lane* TimerPool::take(Worker* worker)
+{
+	if (!worker->ready.empty())
+	{
+		Lane* lane = worker->ready.front();
+		worker->ready.pop_front();
+		return lane;
+	}
+	int size = _workers.size();
+	for (int i = 1; i < size; i++)
+	{
+		Worker* victim = _workers[(worker->index + i) % size];
+		if (victim->ready.empty())
+			continue;
+		Lane* lane = victim->ready.back();
+		victim->ready.pop_back();
+		_stolen++;
+		return lane;
+	}
+	return NULL;
+}
+
+/*
+ * a worker thread. runs a callback from a ready lane at a time, until told
+ * to stop and there are none left.
+ * @param worker the worker
+ */
+void TimerPool::run(Worker* worker)
+{
+	_self.set(worker);
+	_mutex.lock();
+	while (true)
+	{
+		Lane* lane = take(worker);
+		if (!lane)
+		{
+			if (_stopping)
+				break;
+			_work.wait(_mutex);
+			continue;
+		}
+		Task task = lane->tasks.front();
+		lane->tasks.pop_front();
+		worker->current = lane;
+		TimerTime begin = Timer::now();
+		TimerTime waited = begin - task.submitted;
+		_run++;
+		_waited += waited;
+		if (waited > _longestWait)
+			_longestWait = waited;
+		_mutex.unlock();
+
+		bMotionSystem().fireTimer(task.timer);
+
+		TimerTime taken = Timer::now() - begin;
+		_mutex.lock();
+		worker->current = NULL;
+		_ran += taken;
+		if (taken > _longestRun)
+			_longestRun = taken;
+		if (lane->tasks.empty())
+		{
+			lane->busy = false;
+			_busy--;
+		}
+		else
+		{
+			// behind the others queued here, so they get a turn
+			lane->home = worker->index;
+			worker->ready.push_back(lane);
+			_work.signal();
+		}
+		_idle.broadcast();
+	}
+	_mutex.unlock();
+	bMotionSystem().releaseContext();
+	_self.set(NULL);
+	// stop() may get rid of the pool as soon as this is seen
+	_mutex.lock();
+	_alive--;
+	_idle.broadcast();
+	_mutex.unlock();
+}
+
@@ -0,0 +1,111 @@
+#ifndef TIMERPOOL_H
+#define TIMERPOOL_H
+
+#include <deque>
+#include <map>
+#include <vector>
+#include <Thread.h>
+#include <Timer.h>
+
+// the most threads a pool will start
+#define TIMERPOOL_MAX_WORKERS (16)
+
+/*
+ * Runs the callbacks of timers that are due on a few threads of its own, so
+ * that a slow one (say one loading an abstract) doesn't hold up the rest.
+ *
+ * Each library's timers go in a lane of their own and are fired one at a
+ * time in the order they came in, so a plugin never sees its callbacks run
+ * at once or out of order. Lanes with work waiting are queued on a worker,
+ * the one that last ran them if there was one; a worker that runs out
+ * takes lanes from the back of another's queue (work stealing), so nothing
+ * waits behind a callback that is taking its time.
+ *
+ * With no workers the callbacks are fired as they are handed in.
+ */
+class TimerPool
+{
+public:
+	TimerPool();
+	virtual ~TimerPool();
+
+	// running
+	int start(int workers);
+	void submit(Timer* timer);
+	void drain();
+	void stop();
+
+	// statistics
+	int getWorkers();
+	unsigned long getRun();
+	unsigned long getStolen();
+	double getAverageWait();
+	double getLongestWait();
+	double getAverageRun();
+	double getLongestRun();
+
+private:
+	// not copyable
+	TimerPool(const TimerPool& other);
+	TimerPool& operator=(const TimerPool& other);
+
+	struct Task
+	{
+		Timer* timer;
+		// when it was handed in
+		TimerTime submitted;
+	};
+
+	struct Lane
+	{
+		Library* library;
+		std::deque< Task > tasks;
+		// queued on a worker or being run
+		bool busy;
+		// the worker it is queued on, or ran on last
+		int home;
+	};
+
+	struct Worker
+	{
+		TimerPool* pool;
+		int index;
+		Thread* thread;
+		// lanes with work waiting, next to run first
+		std::deque< Lane* > ready;
+		// the lane being run, if any
+		Lane* current;
+	};
+
+	void run(Worker* worker);
+	Lane* take(Worker* worker);
+	static void RunWorker(void* worker);
+
+	std::vector< Worker* > _workers;
+	// every library's lane, kept once made so that firing a timer doesn't
+	// allocate. a busy lane is either on one worker's ready queue or
+	// being run, never both.
+	std::map< Library*, Lane* > _lanes;
+	int _busy;
+	int _next;
+	// workers still running
+	int _alive;
+	bool _stopping;
+	Mutex _mutex;
+	// there is a lane ready, or it is time to stop
+	Condition _work;
+	// a callback has finished, or a worker has
+	Condition _idle;
+	// the Worker of the thread, on workers
+	ThreadLocal _self;
+
+	unsigned long _run;
+	unsigned long _stolen;
+	TimerTime _waited;
+	TimerTime _longestWait;
+	TimerTime _ran;
+	TimerTime _longestRun;
+};
+
+#endif
+
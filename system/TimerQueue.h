@@ -0,0 +1,33 @@
+#ifndef TIMERQUEUE_H
+#define TIMERQUEUE_H
+
+#include <vector>
+#include <Timer.h>
+
+/*
+ * The pending timers, in whatever structure suits how many there are. The
+ * timer thread asks how long it may sleep with getWait(), and takes the
+ * timers that are due with popDue(). Waits are rounded up to the next
+ * millisecond, so a timer is never found not quite ready.
+ *
+ * None of them are thread safe, System guards the queue with its timer
+ * lock. The timers in the queue belong to whoever put them in.
+ */
+class TimerQueue
+{
+public:
+	virtual ~TimerQueue() {}
+
+	// use
+	virtual void push(Timer* timer) = 0;
+	virtual bool remove(Timer* timer) = 0;
+	virtual Timer* popDue(TimerTime now) = 0;
+	virtual void takeAll(std::vector< Timer* >& timers) = 0;
+
+	// information
+	virtual bool getWait(TimerTime now, unsigned long& milli) = 0;
+	virtual int size() const = 0;
+	virtual bool empty() const = 0;
+};
+
+#endif
@@ -0,0 +1,329 @@
+#include <TimerWheel.h>
+
+// the slot holding the timers that are due
+#define DUE (TIMERWHEEL_LEVELS * TIMERWHEEL_SLOTS)
+// the furthest ahead a timer can be placed
+#define REACH (0xffffffffUL)
+
+/*
+ * get the tick a time falls in. ticks are milliseconds, and wrap around
+ * where an unsigned long is 32 bits.
+ * @param time the time, see Timer::now()
+ * @return the tick
+ */
+static unsigned long tickOf(TimerTime time)
+{
+	return (unsigned long)(time / 1000000);
+}
+
+/*
+ * compare two ticks, allowing for them wrapping around
+ * @param a one tick
+ * @param b another tick
+ * @return true if a is before b
+ */
+static bool before(unsigned long a, unsigned long b)
+{
+	return (long)(a - b) < 0;
+}
+
+/*
+ * Constructor. The wheel starts at the current time.
+ */
+TimerWheel::TimerWheel()
+: _current(tickOf(Timer::now()))
+, _size(0)
+{
+	for (int i = 0; i <= DUE; i++)
+		_slots[i] = NULL;
+	for (int i = 0; i < TIMERWHEEL_LEVELS; i++)
+		_counts[i] = 0;
+}
+
+/*
+ * Destructor. The timers still in the wheel belong to whoever put them in.
+ */
+TimerWheel::~TimerWheel()
+{
+
+}
+
+/*
+ * add a timer
+ * @param timer the timer
+ */
+void TimerWheel::push(Timer* timer)
+{
+	insert(timer);
+	_size++;
+}
+
+/*
+ * take a timer out before it fires
+ * @param timer the timer
+ * @return true if it was in the wheel
+ */
+bool TimerWheel::remove(Timer* timer)
+{
+	if (timer->_slot < 0 || timer->_slot > DUE)
+		return false;
+	unlink(timer);
+	_size--;
+	return true;
+}
+
+/*
+ * take out a timer that is due, moving the wheel on to the given time
+ * @param now the time, see Timer::now()
+ * @return the timer, NULL if none are due
+ */
+Timer* TimerWheel::popDue(TimerTime now)
+{
+	advance(tickOf(now));
+	Timer* timer = _slots[DUE];
+	if (!timer)
+		return NULL;
+	unlink(timer);
+	_size--;
+	return timer;
+}
+
+/*
+ * take out all of the timers, in no particular order
+ * @param timers the timers are added to this
+ */
+void TimerWheel::takeAll(std::vector< Timer* >& timers)
+{
+	timers.reserve(timers.size() + _size);
+	for (int i = 0; i <= DUE; i++)
+	{
+		while (_slots[i])
+		{
+			timers.push_back(_slots[i]);
+			unlink(_slots[i]);
+		}
+	}
+	_size = 0;
+}
+
+/*
+ * find out how long until the wheel next has something to do, which is
+ * either a timer being due or a slot on a higher level being spread out
+ * @param now the time, see Timer::now()
+ * @param milli set to the milliseconds to wait, 0 if a timer is due already
+ * @return false if there are no timers
+ */
+bool TimerWheel::getWait(TimerTime now, unsigned long& milli)
+{
+	if (_size == 0)
+		return false;
+	milli = 0;
+	if (_slots[DUE])
+		return true;
+	unsigned long next = _current + REACH;
+	int index = _current & (TIMERWHEEL_SLOTS - 1);
+	for (int k = 0; k < TIMERWHEEL_SLOTS && _counts[0] > 0; k++)
+	{
+		if (_slots[(index + k) & (TIMERWHEEL_SLOTS - 1)])
+		{
+			next = _current + k;
+			break;
+		}
+	}
+	for (int level = 1; level < TIMERWHEEL_LEVELS; level++)
+	{
+		if (_counts[level] == 0)
+			continue;
+		int shift = level * TIMERWHEEL_BITS;
+		unsigned long base = _current >> shift;
+		// the current slot is still to be spread out if the wheel has
+		// stopped right at its start
+		int first = (_current & ((1UL << shift) - 1)) == 0 ? 0 : 1;
+		for (int k = first; k < first + TIMERWHEEL_SLOTS; k++)
+		{
+			int slot = level * TIMERWHEEL_SLOTS +
+				((base + k) & (TIMERWHEEL_SLOTS - 1));
+			if (!_slots[slot])
+				continue;
+			unsigned long start = (base + k) << shift;
+			if (before(start, next))
+				next = start;
+			break;
+		}
+	}
+	// a whole number of ticks, so the wait is rounded up
+	unsigned long tick = tickOf(now);
+	if (before(tick, next))
+		milli = next - tick;
+	return true;
+}
+
+/*
+ * get the number of timers
+ * @return timer count
+ */
+int TimerWheel::size() const
+{
+	return _size;
+}
+
+/*
+ * check if there are no timers
+ * @return true or false
+ */
+bool TimerWheel::empty() const
+{
+	return _size == 0;
+}
+
+/*
+ * put a timer in the slot for when it fires, on the lowest level that
+ * reaches that far. one that is due already goes straight on the due list.
+ * @param timer the timer
+ */
+void TimerWheel::insert(Timer* timer)
+{
+	// the tick it is due by, rounded up so that it is never early
+	unsigned long deadline = tickOf(timer->getDeadline() + 999999);
+	if (before(deadline, _current))
+	{
+		append(DUE, timer);
+		return;
+	}
+	unsigned long delta = deadline - _current;
+	int level = 0;
+	while (level < TIMERWHEEL_LEVELS - 1 &&
+			delta >> ((level + 1) * TIMERWHEEL_BITS) != 0)
+		level++;
+	// further than the wheel reaches, it is put back when it gets there
+	if (delta > REACH)
+		deadline = _current + REACH;
+	int index = (deadline >> (level * TIMERWHEEL_BITS)) &
+		(TIMERWHEEL_SLOTS - 1);
+	append(level * TIMERWHEEL_SLOTS + index, timer);
+	_counts[level]++;
+}
+
+/*
+ * add a timer to the end of a slot's list
+ * @param slot the slot
+ * @param timer the timer
+ */
+void TimerWheel::append(int slot, Timer* timer)
+{
+	timer->_slot = slot;
+	Timer* head = _slots[slot];
+	if (!head)
+	{
+		timer->_prev = timer;
+		timer->_next = timer;
+		_slots[slot] = timer;
+		return;
+	}
+	// the list is a ring, the head's previous timer is the last
+	Timer* last = head->_prev;
+	last->_next = timer;
+	timer->_prev = last;
+	timer->_next = head;
+	head->_prev = timer;
+}
+
+/*
+ * take a timer out of its slot's list
+ * @param timer the timer
+ */
+void TimerWheel::unlink(Timer* timer)
+{
+	int slot = timer->_slot;
+	if (timer->_next == timer)
+		_slots[slot] = NULL;
+	else
+	{
+		timer->_prev->_next = timer->_next;
+		timer->_next->_prev = timer->_prev;
+		if (_slots[slot] == timer)
+			_slots[slot] = timer->_next;
+	}
+	if (slot < DUE)
+		_counts[slot / TIMERWHEEL_SLOTS]--;
+	timer->_prev = NULL;
+	timer->_next = NULL;
+	timer->_slot = -1;
+}
+
+/*
+ * spread out the timers in the current slot of a level over the levels
+ * below, now that time has reached it
+ * @param level the level, 1 or more
+ */
+void TimerWheel::cascade(int level)
+{
+	int slot = level * TIMERWHEEL_SLOTS + ((_current >>
+				(level * TIMERWHEEL_BITS)) &
+			(TIMERWHEEL_SLOTS - 1));
+	while (_slots[slot])
+	{
+		Timer* timer = _slots[slot];
+		unlink(timer);
+		insert(timer);
+	}
+}
+
+/*
+ * move the wheel on to a given tick, putting the timers that are due on
+ * the due list
+ * @param now the tick
+ */
+void TimerWheel::advance(unsigned long now)
+{
+	while (!before(now, _current))
+	{
+		// skip ahead over levels with nothing in them
+		int empty = 0;
+		while (empty < TIMERWHEEL_LEVELS && _counts[empty] == 0)
+			empty++;
+		if (empty == TIMERWHEEL_LEVELS)
+		{
+			_current = now + 1;
+			break;
+		}
+		if (empty > 0)
+		{
+			// the next slot start on that level, which may be where
+			// the wheel is already
+			int shift = empty * TIMERWHEEL_BITS;
+			unsigned long mask = (1UL << shift) - 1;
+			unsigned long boundary = ((_current + mask) >> shift) <<
+				shift;
+			if (before(now, boundary))
+			{
+				_current = now + 1;
+				break;
+			}
+			_current = boundary;
+		}
+
+		// the start of a slot on a higher level, spread it out. the
+		// highest first, its timers may land in the others
+		int index = _current & (TIMERWHEEL_SLOTS - 1);
+		if (index == 0)
+		{
+			int level = 1;
+			while (level < TIMERWHEEL_LEVELS - 1 &&
+					((_current >> (level * TIMERWHEEL_BITS)) &
+					 (TIMERWHEEL_SLOTS - 1)) == 0)
+				level++;
+			for (; level > 0; level--)
+				cascade(level);
+		}
+
+		while (_slots[index])
+		{
+			Timer* timer = _slots[index];
+			unlink(timer);
+			append(DUE, timer);
+		}
+		_current++;
+	}
+}
+
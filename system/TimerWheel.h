@@ -0,0 +1,63 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <vector>
+#include <TimerQueue.h>
+
+// levels in the wheel, and slots in each level as a power of two. four
+// levels of 256 one millisecond slots cover 49 days
+#define TIMERWHEEL_LEVELS (4)
+#define TIMERWHEEL_BITS (8)
+#define TIMERWHEEL_SLOTS (1 << TIMERWHEEL_BITS)
+
+/*
+ * The pending timers, in a hashed hierarchical timing wheel with one
+ * millisecond ticks. The first level has a slot for each of the next 256
+ * milliseconds, the next a slot for each of the next 256 stretches of 256
+ * milliseconds, and so on. A timer goes in the slot for when it fires on
+ * the lowest level that reaches that far, and as time reaches the start of
+ * a slot on a higher level its timers are spread out over the levels
+ * below.
+ *
+ * Each slot is a list running through the timers themselves, so adding and
+ * removing a timer is O(1) however many there are. Timers that fire in
+ * the same millisecond come out in the order they went in, as long as they
+ * went in on the same level. Stretches with nothing to do are skipped
+ * whole.
+ *
+ * Deadlines are rounded up to the next tick, so a timer is never early but
+ * can be up to a millisecond late.
+ */
+class TimerWheel : public TimerQueue
+{
+public:
+	TimerWheel();
+	virtual ~TimerWheel();
+
+	// use
+	void push(Timer* timer);
+	bool remove(Timer* timer);
+	Timer* popDue(TimerTime now);
+	void takeAll(std::vector< Timer* >& timers);
+
+	// information
+	bool getWait(TimerTime now, unsigned long& milli);
+	int size() const;
+	bool empty() const;
+
+private:
+	void insert(Timer* timer);
+	void append(int slot, Timer* timer);
+	void unlink(Timer* timer);
+	void cascade(int level);
+	void advance(unsigned long now);
+
+	// the slots for each level, then the timers that are due
+	Timer* _slots[TIMERWHEEL_LEVELS * TIMERWHEEL_SLOTS + 1];
+	int _counts[TIMERWHEEL_LEVELS];
+	// the next tick to be dealt with
+	unsigned long _current;
+	int _size;
+};
+
+#endif
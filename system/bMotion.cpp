@@ -6,6 +6,10 @@
 #include <stdarg.h>
 #include <Abstract.h>
 #include <Mood.h>
+#include <Normaliser.h>
+
+// cleans up the lines coming into the event handlers
+static Normaliser lineNormaliser;
 
 /*
  * initialise bMotion
@@ -32,8 +36,11 @@ extern "C" bool bMotionInit(const char* confFileName)
 		bMotionLog(1, "failed to load any useable plugins");
 		return false;
 	}
-	bMotionSystem().addTimer(300000, bMotionAbstractGarbageCollect, NULL);
-	bMotionSystem().addTimer(1000, bMotionMoodDrift, NULL);
+	bMotionSystem().addTimer(300000, bMotionAbstractGarbageCollect, NULL,
+			300000);
+	bMotionSystem().addTimer(ABSTRACTJOURNAL_FLUSH_INTERVAL,
+			bMotionAbstractFlush, NULL, ABSTRACTJOURNAL_FLUSH_INTERVAL);
+	bMotionSystem().addTimer(1000, bMotionMoodDrift, NULL, 1000);
 	return true;
 }
 
@@ -149,22 +156,18 @@ extern "C" bool bMotionEventMain(const char* nick, const char* host,
 	if (!bMotionSettings().isChannelAllowed(channel))
 		return false;
 
-	// filter out bolds and stuff like that
-	String processedText(text);
-	processedText.replaceAll("\\002", "");
-	processedText.replaceAll("\\022", "");
-	processedText.replaceAll("\\037", "");
-	processedText.replaceAll("\\003\\[0-9\\]+(,\\[0-9+\\])?", "");
-
-	// trim
-	processedText.trim();
+	// filter out bolds and stuff like that, and trim. the views below all
+	// point into the normaliser's buffer, nothing is copied unless a
+	// plugin needs it
+	StringRef processedText(lineNormaliser.normalise(text,
+				NORMALISE_STRIP_CODES | NORMALISE_TRIM));
 
 	// check for admin
 	if (processedText.startsWith("!bmadmin") && 
 			(processedText.length() == 8 ||
 			 processedText[8] == ' '))
 	{
-		String adminCommand;
+		StringRef adminCommand;
 		int pos = processedText.indexOf(' ', 9);
 		if (pos > 0)
 		{
@@ -174,10 +177,10 @@ extern "C" bool bMotionEventMain(const char* nick, const char* host,
 		else
 		{
 			adminCommand = processedText.substring(9);
-			processedText = "";
+			processedText = StringRef();
 		}
-		adminCommand.trim();
-		processedText.trim();
+		adminCommand = adminCommand.trimmed();
+		processedText = processedText.trimmed();
 		if (adminCommand.length() > 0)
 		{
 			if (adminCommand.equals("rehash") && 
@@ -276,9 +279,8 @@ extern "C" bool bMotionEventAction(const char* nick, const char* host,
 	if (!bMotionSettings().isChannelAllowed(dest))
 		return false;
 
-	String processedText(text);
-	processedText.trim();
-	processedText.replaceAll("  +", " ");
+	StringRef processedText(lineNormaliser.normalise(text,
+				NORMALISE_TRIM | NORMALISE_COLLAPSE_SPACES));
 
 	// run complex plugins
 	std::vector< ComplexPlugin* > complexplugins = 
@@ -403,14 +405,42 @@ extern "C" bool bMotionIsBotnick(const char* /*name*/)
  * @param milli milliseconds to wait for the event
  * @param callback callback to use after milli milliseconds
  * @param param arbitrary parameter to pass to callback
- * @return true or false.
+ * @return a handle for bMotionCancelTimer(), 0 if the timer couldn't be
+ * 	   added.
  */
-extern "C" bool bMotionAddTimer(unsigned long milli, void(*callback)(void*),
-		void* param)
+extern "C" unsigned long bMotionAddTimer(unsigned long milli,
+		void(*callback)(void*), void* param)
 {
 	return bMotionSystem().addTimer(milli, callback, param);
 }
 
+/*
+ * Add a timer event that happens over and over until it is cancelled.
+ * @param milli milliseconds between each event, and before the first
+ * @param callback callback to use every milli milliseconds
+ * @param param arbitrary parameter to pass to callback
+ * @return a handle for bMotionCancelTimer(), 0 if the timer couldn't be
+ * 	   added.
+ */
+extern "C" unsigned long bMotionAddRepeatTimer(unsigned long milli,
+		void(*callback)(void*), void* param)
+{
+	if (milli == 0)
+		return 0;
+	return bMotionSystem().addTimer(milli, callback, param, milli);
+}
+
+/*
+ * Stop a timer event from happening.
+ * @param handle the handle the timer was added with
+ * @return true or false. false if it has already happened, or never
+ * 	   existed.
+ */
+extern "C" bool bMotionCancelTimer(unsigned long handle)
+{
+	return bMotionSystem().cancelTimer(handle);
+}
+
 /*
  * switch the system to a different language.
  * @param language string representation of language (i.e. "en" is english)
@@ -446,17 +476,35 @@ extern "C" bool bMotionAbstractRegister(const char* type)
  */
 extern "C" bool bMotionAbstractBatchAdd(const char* type, ...)
 {
+	std::vector< const char* > values;
 	va_list ap;
 	va_start(ap, type);
-	char* val = va_arg(ap, char*);
+	const char* val = va_arg(ap, const char*);
 	while (val != ABSTRACT_END)
 	{
-		if (!bMotionSystem().abstractAddValue(type, val))
-			return false;
-		val = va_arg(ap, char*);
+		values.push_back(val);
+		val = va_arg(ap, const char*);
 	};
 	va_end(ap);
-	return true;
+	if (values.size() == 0)
+		return bMotionSystem().abstractAddValues(type, NULL, 0);
+	return bMotionSystem().abstractAddValues(type, &values[0],
+			values.size());
+}
+
+/*
+ * Add an array of strings into an abstract
+ * @param type the type name of the abstract
+ * @param values the strings
+ * @param n the number of strings
+ * @return true or false
+ */
+extern "C" bool bMotionAbstractAddMany(const char* type,
+		const char** values, size_t n)
+{
+	if (!values && n > 0)
+		return false;
+	return bMotionSystem().abstractAddValues(type, values, n);
 }
 
 /*
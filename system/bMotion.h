@@ -5,8 +5,8 @@
 #include <System.h>
 
 #define BMOTION_MAX_ABSTRACTS (300)
-// ten minute life span for unused abstracts
-#define BMOTION_MAX_ABSTRACT_AGE (600)
+// how long a line waits for an abstract that isn't loaded yet, in milliseconds
+#define BMOTION_ABSTRACT_WAIT (100)
 // abstract list end value
 #define ABSTRACT_END (NULL)
 
@@ -0,0 +1,41 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+
+/*
+ * bits shared by the unit tests. each test is a program of its own that
+ * returns 0 if every CHECK() passed.
+ */
+
+// failed checks so far
+static int checkFailures = 0;
+
+// note a failure, with where it happened, if the test is false
+#define CHECK(test) \
+	do \
+	{ \
+		if (!(test)) \
+		{ \
+			printf("%s:%d: check failed: %s\n", __FILE__, \
+					__LINE__, #test); \
+			checkFailures++; \
+		} \
+	} while (0)
+
+/*
+ * report how the checks went
+ * @param name the name of the test
+ * @return what main() should return
+ */
+static int checkResult(const char* name)
+{
+	if (checkFailures)
+		printf("%s: %d checks failed\n", name, checkFailures);
+	else
+		printf("%s: ok\n", name);
+	return checkFailures ? 1 : 0;
+}
+
+#endif
+
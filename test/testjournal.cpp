@@ -0,0 +1,298 @@
+#include <AbstractJournal.h>
+#include <bString.h>
+#include <StringRef.h>
+#include <set>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "check.h"
+
+/*
+ * crash recovery of the abstract journal: changes that were flushed survive
+ * the bot being killed before or during a compaction, ones that weren't are
+ * lost cleanly, and a half written change is dropped.
+ */
+
+#define BASE "testjournal.txt"
+#define JOURNAL "testjournal.journal"
+#define TEMP "testjournal.txt.tmp"
+// values in the text file to start with
+#define BASE_VALUES (400)
+
+typedef std::set< String, ltstr > Values;
+
+/*
+ * start again with a text file of BASE_VALUES values and no journal
+ */
+static void reset()
+{
+	remove(JOURNAL);
+	remove(TEMP);
+	FILE* fp = fopen(BASE, "wb");
+	for (int i = 0; i < BASE_VALUES; i++)
+		fprintf(fp, "value %d\n", i);
+	fclose(fp);
+}
+
+/*
+ * put some text on the end of a file
+ * @param filename the file
+ * @param text the text
+ */
+static void append(const char* filename, const char* text)
+{
+	FILE* fp = fopen(filename, "ab");
+	fputs(text, fp);
+	fclose(fp);
+}
+
+/*
+ * the changes made by the tests: the odd values are removed and as many
+ * new ones are added
+ * @param journal where to record them
+ */
+static void change(AbstractJournal& journal)
+{
+	char value[32];
+	for (int i = 0; i < BASE_VALUES; i++)
+	{
+		sprintf(value, "value %d", i);
+		if (i % 2)
+			journal.record(false, StringRef(value));
+		sprintf(value, "added %d", i);
+		journal.record(true, StringRef(value));
+	}
+}
+
+/*
+ * the values there should be once change() has been flushed
+ * @return the values
+ */
+static Values changed()
+{
+	Values values;
+	char value[32];
+	for (int i = 0; i < BASE_VALUES; i++)
+	{
+		sprintf(value, "value %d", i);
+		if (i % 2 == 0)
+			values.insert(value);
+		sprintf(value, "added %d", i);
+		values.insert(value);
+	}
+	return values;
+}
+
+/*
+ * apply a replayed change to a set of values
+ */
+static void apply(void* values, bool add, const StringRef& value)
+{
+	if (add)
+		((Values*)values)->insert(value.toString());
+	else
+		((Values*)values)->erase(value.toString());
+}
+
+/*
+ * load the values the way an Abstract does after a restart: the text file,
+ * then the journal replayed over it
+ * @return the values
+ */
+static Values load()
+{
+	Values values;
+	FILE* fp = fopen(BASE, "rb");
+	char line[256];
+	while (fp && fgets(line, sizeof(line), fp))
+	{
+		String value(line);
+		value.trim();
+		if (value.length() > 0)
+			values.insert(value);
+	}
+	if (fp)
+		fclose(fp);
+	AbstractJournal journal;
+	journal.setFiles(BASE, JOURNAL);
+	journal.replay(apply, &values);
+	return values;
+}
+
+/*
+ * wait for a child to die of SIGKILL
+ * @param child the child
+ * @return true if that is how it went
+ */
+static bool killed(pid_t child)
+{
+	int status;
+	if (waitpid(child, &status, 0) != child)
+		return false;
+	return WIFSIGNALED(status) && WTERMSIG(status) == SIGKILL;
+}
+
+/*
+ * killed before the changes are flushed, in the middle of writing one out
+ */
+static void testKillBeforeFlush()
+{
+	reset();
+	pid_t child = fork();
+	if (child == 0)
+	{
+		AbstractJournal journal;
+		journal.setFiles(BASE, JOURNAL);
+		change(journal);
+		journal.flush();
+		journal.record(true, StringRef("never flushed"));
+		// the start of a change that didn't make it to the end
+		append(JOURNAL, "+half a chan");
+		raise(SIGKILL);
+	}
+	CHECK(killed(child));
+	Values values = load();
+	CHECK(values == changed());
+	CHECK(!values.count("never flushed"));
+	CHECK(!values.count("half a chan"));
+
+	// changes after the restart don't get stuck onto the half line
+	AbstractJournal journal;
+	journal.setFiles(BASE, JOURNAL);
+	journal.record(true, StringRef("after restart"));
+	CHECK(journal.flush());
+	values = load();
+	CHECK(values.count("after restart"));
+	CHECK(values.size() == changed().size() + 1);
+}
+
+/*
+ * killed with a big journal that was due to be compacted
+ */
+static void testKillBeforeCompact()
+{
+	reset();
+	pid_t child = fork();
+	if (child == 0)
+	{
+		AbstractJournal journal;
+		journal.setFiles(BASE, JOURNAL);
+		change(journal);
+		journal.flush();
+		raise(SIGKILL);
+	}
+	CHECK(killed(child));
+	CHECK(load() == changed());
+
+	// and it compacts fine next time round
+	AbstractJournal journal;
+	journal.setFiles(BASE, JOURNAL);
+	CHECK(journal.compact());
+	CHECK(journal.isEmpty());
+	CHECK(access(JOURNAL, F_OK) != 0);
+	CHECK(load() == changed());
+}
+
+/*
+ * the states a compaction goes through, as left by a kill at each step
+ */
+static void testCompactionSteps()
+{
+	// the new text file half written, not renamed yet
+	reset();
+	{
+		AbstractJournal journal;
+		journal.setFiles(BASE, JOURNAL);
+		change(journal);
+		CHECK(journal.flush());
+	}
+	append(TEMP, "value 0\nadded 0\nadd");
+	CHECK(load() == changed());
+	{
+		// the leftover is written over
+		AbstractJournal journal;
+		journal.setFiles(BASE, JOURNAL);
+		CHECK(journal.compact());
+		CHECK(access(TEMP, F_OK) != 0);
+		CHECK(load() == changed());
+	}
+
+	// renamed into place, but the journal not removed
+	reset();
+	{
+		AbstractJournal journal;
+		journal.setFiles(BASE, JOURNAL);
+		change(journal);
+		CHECK(journal.flush());
+	}
+	FILE* fp = fopen(TEMP, "wb");
+	Values values = changed();
+	Values::iterator iter = values.begin();
+	while (iter != values.end())
+	{
+		fprintf(fp, "%s\n", (const char*)*iter);
+		++iter;
+	}
+	fclose(fp);
+	CHECK(rename(TEMP, BASE) == 0);
+	CHECK(load() == changed());
+}
+
+/*
+ * killed at random points while compacting
+ * @param rounds how many times to try
+ */
+static void testKillDuringCompact(int rounds)
+{
+	for (int i = 0; i < rounds; i++)
+	{
+		reset();
+		int ready[2];
+		if (pipe(ready) != 0)
+		{
+			CHECK(!"pipe");
+			return;
+		}
+		pid_t child = fork();
+		if (child == 0)
+		{
+			close(ready[0]);
+			AbstractJournal journal;
+			journal.setFiles(BASE, JOURNAL);
+			change(journal);
+			journal.flush();
+			// everything is on disk, so nothing may be lost now
+			char c = 0;
+			if (write(ready[1], &c, 1) != 1)
+				_exit(1);
+			journal.compact();
+			pause();
+		}
+		close(ready[1]);
+		char c;
+		CHECK(read(ready[0], &c, 1) == 1);
+		close(ready[0]);
+		usleep(rand() % 2000);
+		kill(child, SIGKILL);
+		CHECK(killed(child));
+		CHECK(load() == changed());
+	}
+}
+
+int main(int, char**)
+{
+	srand(getpid());
+	testKillBeforeFlush();
+	testKillBeforeCompact();
+	testCompactionSteps();
+	testKillDuringCompact(20);
+	remove(BASE);
+	remove(JOURNAL);
+	remove(TEMP);
+	return checkResult("testjournal");
+}
+
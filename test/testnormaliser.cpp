@@ -0,0 +1,186 @@
+#include <Normaliser.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <string>
+#include "check.h"
+
+/*
+ * the line clean up done on incoming text: formatting codes, trimming and
+ * runs of spaces. everything else, case and punctuation included, has to
+ * get through untouched since plugins match on it.
+ */
+
+// all the flags
+#define NORMALISE_ALL (NORMALISE_STRIP_CODES | NORMALISE_TRIM | \
+		NORMALISE_COLLAPSE_SPACES)
+
+/*
+ * normalise a line
+ * @param text the line
+ * @param flags the NORMALISE_ flags
+ * @return the result
+ */
+static std::string normalise(const char* text, int flags = NORMALISE_ALL)
+{
+	static Normaliser normaliser;
+	const char* result = normaliser.normalise(text, flags);
+	CHECK(normaliser.length() == (int)strlen(result));
+	return result;
+}
+
+/*
+ * a character at a time, the way normalise() is meant to behave. the
+ * Normaliser skips over plain runs 16 bytes at a time when built with
+ * SSE2, this is what it has to agree with.
+ * @param text the line
+ * @param flags the NORMALISE_ flags
+ * @return the result
+ */
+static std::string reference(const std::string& text, int flags)
+{
+	std::string out;
+	unsigned int i = 0;
+	while (i < text.length())
+	{
+		char c = text[i++];
+		if ((flags & NORMALISE_STRIP_CODES) && c != '\0' &&
+				strchr("\002\003\017\022\026\037", c))
+		{
+			if (c != '\003' || i >= text.length() ||
+					!isdigit((unsigned char)text[i]))
+				continue;
+			i++;
+			if (i < text.length() &&
+					isdigit((unsigned char)text[i]))
+				i++;
+			if (i + 1 < text.length() && text[i] == ',' &&
+					isdigit((unsigned char)text[i + 1]))
+			{
+				i += 2;
+				if (i < text.length() &&
+						isdigit((unsigned char)text[i]))
+					i++;
+			}
+			continue;
+		}
+		if ((flags & NORMALISE_TRIM) && out.empty() &&
+				isspace((unsigned char)c))
+			continue;
+		if ((flags & NORMALISE_COLLAPSE_SPACES) && c == ' ' &&
+				!out.empty() && out[out.length() - 1] == ' ')
+			continue;
+		out += c;
+	}
+	if (flags & NORMALISE_TRIM)
+	{
+		while (!out.empty() &&
+				isspace((unsigned char)out[out.length() - 1]))
+			out.erase(out.length() - 1);
+	}
+	return out;
+}
+
+static void testCodes()
+{
+	CHECK(normalise("\002bold\002 text") == "bold text");
+	CHECK(normalise("\037under\037\026rev\026\017") == "underrev");
+	CHECK(normalise("\022old reverse") == "old reverse");
+	// colours: up to two digits, then a comma and up to two more
+	CHECK(normalise("\0034red") == "red");
+	CHECK(normalise("\00304red") == "red");
+	CHECK(normalise("\0034,12on blue") == "on blue");
+	CHECK(normalise("\00304,1on black") == "on black");
+	CHECK(normalise("\003123 three digits") == "3 three digits");
+	CHECK(normalise("\0034,123") == "3");
+	// a comma without a background is text
+	CHECK(normalise("\0034,red") == ",red");
+	CHECK(normalise("\003plain") == "plain");
+	CHECK(normalise("ends in a colour\003") == "ends in a colour");
+	// digits that aren't after a colour code are left alone
+	CHECK(normalise("002 003 12,34") == "002 003 12,34");
+	CHECK(normalise("\002bold\002", NORMALISE_TRIM) == "\002bold\002");
+}
+
+static void testWhiteSpace()
+{
+	CHECK(normalise("  \t padded \t  ") == "padded");
+	CHECK(normalise("lots    of     spaces") == "lots of spaces");
+	// only spaces are squeezed
+	CHECK(normalise("tab\t\tseparated") == "tab\t\tseparated");
+	// a code between spaces doesn't keep them apart
+	CHECK(normalise("a \002 b") == "a b");
+	CHECK(normalise(" \002 leading") == "leading");
+	CHECK(normalise("   ") == "");
+	CHECK(normalise("") == "");
+	CHECK(normalise(NULL) == "");
+	CHECK(normalise("  two  ", NORMALISE_TRIM) == "two");
+	CHECK(normalise("  two  ", NORMALISE_COLLAPSE_SPACES) == " two ");
+	CHECK(normalise("  a  b  ", 0) == "  a  b  ");
+}
+
+static void testCaseAndPunctuation()
+{
+	CHECK(normalise("Hello THERE, World!") == "Hello THERE, World!");
+	CHECK(normalise("what?!... :) ;-) <3 ^_^") ==
+			"what?!... :) ;-) <3 ^_^");
+	CHECK(normalise("\002MiXeD\002, CaSe.") == "MiXeD, CaSe.");
+	CHECK(normalise("caf\xc3\xa9 \xc3\x89T\xc3\x89") ==
+			"caf\xc3\xa9 \xc3\x89T\xc3\x89");
+}
+
+static void testLongLines()
+{
+	// the 16 byte copying, with things to do on either side of the edges
+	std::string line;
+	for (int i = 0; i < 40; i++)
+		line += "0123456789abcde ";
+	CHECK(normalise(line.c_str()) == line.substr(0, line.length() - 1));
+	std::string spaced = line;
+	spaced[15] = '\002';
+	spaced[31] = ' ';
+	spaced[32] = ' ';
+	CHECK(normalise(spaced.c_str()) == reference(spaced, NORMALISE_ALL));
+	// the buffer is reused for a shorter line
+	CHECK(normalise(" short ") == "short");
+}
+
+/*
+ * random lines heavy in spaces, codes and digits, every mix of flags
+ * @param lines how many
+ */
+static void testAgainstReference(int lines)
+{
+	static const char pieces[] = "  \002\003\017\022\026\037\t0123456789,"
+		"abcXYZ!?.";
+	for (int i = 0; i < lines; i++)
+	{
+		std::string line;
+		int length = rand() % 100;
+		for (int j = 0; j < length; j++)
+			line += pieces[rand() % (sizeof(pieces) - 1)];
+		// long plain runs as well, for the 16 byte copying
+		if (rand() % 2)
+			line.insert(rand() % (line.length() + 1),
+					"a run of plain text, single spaced");
+		int flags = rand() % (NORMALISE_ALL + 1);
+		std::string expected = reference(line, flags);
+		std::string got = normalise(line.c_str(), flags);
+		CHECK(got == expected);
+		if (got != expected)
+			return;
+	}
+}
+
+int main(int, char**)
+{
+	srand(7);
+	testCodes();
+	testWhiteSpace();
+	testCaseAndPunctuation();
+	testLongLines();
+	testAgainstReference(100000);
+	return checkResult("testnormaliser");
+}
+
@@ -0,0 +1,209 @@
+#include <bMotion.h>
+#include <System.h>
+#include <Settings.h>
+#include <Timer.h>
+#include <Thread.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "check.h"
+
+/*
+ * timers armed through System fire on time: never early, and not much
+ * later than asked, with either kind of queue, from 5 ms up to 10 s. each
+ * queue is tried in a process of its own since System picks one for good
+ * when the first timer is added. the two run side by side, so the whole
+ * test takes about as long as the longest timer.
+ */
+
+// how late a timer may fire, in milliseconds
+#define LATEST (50)
+// how late they may fire on average
+#define AVERAGE_LATEST (10)
+// one shot timers armed, spread over the first 350 ms
+#define ONE_SHOTS (40)
+// and more at about 1 s and 10 s, this many of each
+#define LONG_SHOTS (3)
+// all the one shot timers
+#define ALL_SHOTS (ONE_SHOTS + 2 * LONG_SHOTS)
+// firings of the repeating timer looked at
+#define REPEATS (20)
+// milliseconds between them
+#define REPEAT_PERIOD (25)
+
+// a timer and when it fired
+struct Probe
+{
+	// when it should fire, for a repeating timer the first time
+	TimerTime due;
+	TimerTime fired[REPEATS];
+	int firings;
+};
+
+static Mutex probeMutex;
+
+/*
+ * timer callback, notes the time
+ * @param probe the Probe
+ */
+static void fire(void* param)
+{
+	TimerTime now = Timer::now();
+	Probe* probe = (Probe*)param;
+	probeMutex.lock();
+	if (probe->firings < REPEATS)
+		probe->fired[probe->firings] = now;
+	probe->firings++;
+	probeMutex.unlock();
+}
+
+/*
+ * how late a firing was
+ * @param due when it was due
+ * @param fired when it fired
+ * @return milliseconds, less than 0 if it was early
+ */
+static double lateness(TimerTime due, TimerTime fired)
+{
+	if (fired < due)
+		return -(double)(due - fired) / 1000000;
+	return (double)(fired - due) / 1000000;
+}
+
+/*
+ * arm timers and check when they fire
+ * @param scheme "heap" or "wheel"
+ * @return what the process should exit with
+ */
+static int testScheme(const char* scheme)
+{
+	// one each, since both are tried at once
+	String filename("testtimers-");
+	filename.concat(scheme);
+	filename.concat(".conf");
+	FILE* fp = fopen(filename, "wb");
+	fprintf(fp, "timers = %s\n", scheme);
+	fclose(fp);
+	bool parsed = bMotionSettings().parseConfigFile(filename);
+	remove(filename);
+	CHECK(parsed);
+
+	static Probe probes[ALL_SHOTS + 1];
+	for (int i = 0; i <= ALL_SHOTS; i++)
+		probes[i].firings = 0;
+	System& system = bMotionSystem();
+	// spread out, some at the same time, short and longer
+	for (int i = 0; i < ONE_SHOTS; i++)
+	{
+		unsigned long milli = 5 + (i % 10) * 37 + (i / 10) * 3;
+		probes[i].due = Timer::now() + milli * 1000000ULL;
+		CHECK(system.addTimer(milli, fire, &probes[i]) != 0);
+	}
+	for (int i = 0; i < 2 * LONG_SHOTS; i++)
+	{
+		unsigned long milli = (i < LONG_SHOTS ? 1000 : 10000) +
+			(i % LONG_SHOTS) * 7;
+		Probe& probe = probes[ONE_SHOTS + i];
+		probe.due = Timer::now() + milli * 1000000ULL;
+		CHECK(system.addTimer(milli, fire, &probe) != 0);
+	}
+	Probe& repeat = probes[ALL_SHOTS];
+	repeat.due = Timer::now() + REPEAT_PERIOD * 1000000ULL;
+	unsigned long handle = system.addTimer(REPEAT_PERIOD, fire, &repeat,
+			REPEAT_PERIOD);
+	CHECK(handle != 0);
+
+	// the last is due in just over 10 s
+	for (int waited = 0; waited < 15000; waited += 10)
+	{
+		probeMutex.lock();
+		bool done = repeat.firings >= REPEATS;
+		for (int i = 0; i < ALL_SHOTS; i++)
+			done = done && probes[i].firings > 0;
+		probeMutex.unlock();
+		if (done)
+			break;
+		usleep(10000);
+	}
+	CHECK(system.cancelTimer(handle));
+
+	probeMutex.lock();
+	double total = 0;
+	double latest = 0;
+	int firings = 0;
+	for (int i = 0; i < ALL_SHOTS; i++)
+	{
+		CHECK(probes[i].firings == 1);
+		if (probes[i].firings != 1)
+			continue;
+		double late = lateness(probes[i].due, probes[i].fired[0]);
+		CHECK(late >= 0);
+		CHECK(late <= LATEST);
+		total += late;
+		if (late > latest)
+			latest = late;
+		firings++;
+	}
+	CHECK(repeat.firings >= REPEATS);
+	for (int i = 0; i < REPEATS && i < repeat.firings; i++)
+	{
+		// each one is due a period after the last was due
+		double late = lateness(repeat.due + i * REPEAT_PERIOD *
+				1000000ULL, repeat.fired[i]);
+		CHECK(late >= 0);
+		CHECK(late <= LATEST);
+		total += late;
+		if (late > latest)
+			latest = late;
+		firings++;
+	}
+	probeMutex.unlock();
+	double average = firings ? total / firings : 0;
+	printf("%s: %d firings, %.3f ms late on average, %.3f ms at worst\n",
+			scheme, firings, average, latest);
+	CHECK(average <= AVERAGE_LATEST);
+	system.killTimers();
+	return checkResult(scheme);
+}
+
+/*
+ * start a test in a process of its own
+ * @param scheme the queue to try
+ * @return the process
+ */
+static pid_t startChild(const char* scheme)
+{
+	fflush(stdout);
+	pid_t child = fork();
+	if (child == 0)
+	{
+		int result = testScheme(scheme);
+		fflush(stdout);
+		_exit(result);
+	}
+	return child;
+}
+
+/*
+ * wait for a test started by startChild()
+ * @param child the process
+ * @return true if it passed
+ */
+static bool finishChild(pid_t child)
+{
+	int status;
+	if (child < 0 || waitpid(child, &status, 0) != child)
+		return false;
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int main(int, char**)
+{
+	pid_t heap = startChild("heap");
+	pid_t wheel = startChild("wheel");
+	CHECK(finishChild(heap));
+	CHECK(finishChild(wheel));
+	return checkResult("testtimers");
+}
+
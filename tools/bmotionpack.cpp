@@ -0,0 +1,38 @@
+#include <stdio.h>
+#include <AbstractPack.h>
+
+/*
+ * compiles the abstracts of one or more languages into packs the library
+ * can map at startup, see AbstractPack.h
+ */
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		printf("usage: %s <abstract directory> <language> [<language> ...]\n",
+				argv[0]);
+		printf("builds <abstract directory>/<language>.pack from the .txt files"
+				" in <abstract directory>/<language>\n");
+		return -1;
+	}
+
+	String directory(argv[1]);
+	int failed = 0;
+	for (int i = 2; i < argc; i++)
+	{
+		String source(directory);
+		source += "/";
+		source += argv[i];
+		String pack(source);
+		pack += ".pack";
+		if (AbstractPack::build(source, pack))
+			printf("built %s\n", (const char*)pack);
+		else
+		{
+			printf("failed to build %s\n", (const char*)pack);
+			failed++;
+		}
+	}
+	return failed ? -1 : 0;
+}
+
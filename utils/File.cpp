@@ -220,6 +220,18 @@ bool File::writeLine(const String& line)
 	return true;
 }
 
+bool File::write(const char* data, int length)
+{
+	if (!_fp)
+	{
+		bMotionLog(1, "file is not open");
+		return false;
+	}
+	if (length <= 0)
+		return true;
+	return fwrite(data, 1, length, _fp) == (size_t)length;
+}
+
 bool File::emptyFile()
 {
 	if (!_fp)
@@ -28,6 +28,7 @@ public:
 	bool close();
 
 	bool writeLine(const String& line);
+	bool write(const char* data, int length);
 	bool emptyFile();
 
 private:
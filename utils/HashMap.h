@@ -0,0 +1,290 @@
+/*
+ * HashMap.h : open addressing hash table
+ */
+
+#ifndef BMHASHMAP_H
+#define BMHASHMAP_H
+
+#include <stdlib.h>
+
+// smallest table, must be a power of 2
+#define HASHMAP_MIN_CAPACITY (16)
+
+/*
+ * A hash table using open addressing with linear probing. H is a functor
+ * giving an unsigned int hash of a key and E a functor testing two keys for
+ * equality. K and V must be default constructible and assignable.
+ *
+ * Entries move around when the table grows or an entry is erased, so
+ * pointers to values and iterators are only good until the next insert or
+ * erase.
+ */
+template < class K, class V, class H, class E >
+class HashMap
+{
+public:
+	struct Entry
+	{
+		K first;
+		V second;
+	};
+
+	class iterator
+	{
+	public:
+		iterator(HashMap* map = NULL, int index = 0)
+		: _map(map)
+		, _index(index)
+		{
+			skip();
+		}
+		Entry& operator*() const { return _map->_entries[_index]; }
+		Entry* operator->() const { return &_map->_entries[_index]; }
+		iterator& operator++()
+		{
+			_index++;
+			skip();
+			return *this;
+		}
+		bool operator==(const iterator& other) const
+		{
+			return _index == other._index;
+		}
+		bool operator!=(const iterator& other) const
+		{
+			return _index != other._index;
+		}
+
+	private:
+		void skip()
+		{
+			while (_map && _index < _map->_capacity &&
+					!_map->_used[_index])
+				_index++;
+		}
+
+		HashMap* _map;
+		int _index;
+	};
+
+	HashMap()
+	: _entries(NULL)
+	, _hashes(NULL)
+	, _used(NULL)
+	, _capacity(0)
+	, _size(0)
+	{
+
+	}
+
+	virtual ~HashMap()
+	{
+		delete [] _entries;
+		delete [] _hashes;
+		delete [] _used;
+	}
+
+	/*
+	 * find the value for a key
+	 * @return pointer to the value or NULL if the key isn't in the map
+	 */
+	V* find(const K& key)
+	{
+		int slot = slotOf(key, _hash(key));
+		return slot < 0 ? NULL : &_entries[slot].second;
+	}
+
+	const V* find(const K& key) const
+	{
+		int slot = slotOf(key, _hash(key));
+		return slot < 0 ? NULL : &_entries[slot].second;
+	}
+
+	/*
+	 * add a key and value if the key isn't already in the map
+	 * @return true if it was added, false if the key was already there
+	 */
+	bool insert(const K& key, const V& value)
+	{
+		unsigned int hash = _hash(key);
+		if (slotOf(key, hash) >= 0)
+			return false;
+		// place() can move _entries
+		int slot = place(hash);
+		_entries[slot] = make(key, value);
+		return true;
+	}
+
+	/*
+	 * get the value for a key, adding a default value if it isn't there
+	 * @return the value
+	 */
+	V& operator[](const K& key)
+	{
+		unsigned int hash = _hash(key);
+		int slot = slotOf(key, hash);
+		if (slot < 0)
+		{
+			slot = place(hash);
+			_entries[slot] = make(key, V());
+		}
+		return _entries[slot].second;
+	}
+
+	/*
+	 * remove a key from the map
+	 * @return true if it was there, false if not
+	 */
+	bool erase(const K& key)
+	{
+		int slot = slotOf(key, _hash(key));
+		if (slot < 0)
+			return false;
+		// shift back the entries after it so probing still finds them
+		int mask = _capacity - 1;
+		int next = slot;
+		for (;;)
+		{
+			next = (next + 1) & mask;
+			if (!_used[next])
+				break;
+			int home = _hashes[next] & mask;
+			if (((next - home) & mask) >= ((next - slot) & mask))
+			{
+				_entries[slot] = _entries[next];
+				_hashes[slot] = _hashes[next];
+				slot = next;
+			}
+		}
+		_entries[slot] = Entry();
+		_used[slot] = false;
+		_size--;
+		return true;
+	}
+
+	/*
+	 * remove everything from the map
+	 */
+	void clear()
+	{
+		for (int i = 0; i < _capacity; i++)
+		{
+			if (_used[i])
+				_entries[i] = Entry();
+			_used[i] = false;
+		}
+		_size = 0;
+	}
+
+	int size() const
+	{
+		return _size;
+	}
+
+	bool empty() const
+	{
+		return _size == 0;
+	}
+
+	iterator begin()
+	{
+		return iterator(this, 0);
+	}
+
+	iterator end()
+	{
+		return iterator(this, _capacity);
+	}
+
+private:
+	// not copyable
+	HashMap(const HashMap& other);
+	HashMap& operator=(const HashMap& other);
+
+	static Entry make(const K& key, const V& value)
+	{
+		Entry entry;
+		entry.first = key;
+		entry.second = value;
+		return entry;
+	}
+
+	/*
+	 * find the slot holding a key
+	 * @return slot index or -1
+	 */
+	int slotOf(const K& key, unsigned int hash) const
+	{
+		if (_size == 0)
+			return -1;
+		int mask = _capacity - 1;
+		for (int i = hash & mask; _used[i]; i = (i + 1) & mask)
+		{
+			if (_hashes[i] == hash && _equal(_entries[i].first, key))
+				return i;
+		}
+		return -1;
+	}
+
+	/*
+	 * claim a free slot for a new key, growing the table if needed
+	 * @return slot index
+	 */
+	int place(unsigned int hash)
+	{
+		if ((_size + 1) * 4 > _capacity * 3)
+			grow();
+		int mask = _capacity - 1;
+		int i = hash & mask;
+		while (_used[i])
+			i = (i + 1) & mask;
+		_used[i] = true;
+		_hashes[i] = hash;
+		_size++;
+		return i;
+	}
+
+	void grow()
+	{
+		int oldCapacity = _capacity;
+		Entry* oldEntries = _entries;
+		unsigned int* oldHashes = _hashes;
+		bool* oldUsed = _used;
+
+		_capacity = oldCapacity ? oldCapacity * 2 : HASHMAP_MIN_CAPACITY;
+		_entries = new Entry[_capacity];
+		_hashes = new unsigned int[_capacity];
+		_used = new bool[_capacity];
+		for (int i = 0; i < _capacity; i++)
+			_used[i] = false;
+
+		int mask = _capacity - 1;
+		for (int j = 0; j < oldCapacity; j++)
+		{
+			if (!oldUsed[j])
+				continue;
+			int i = oldHashes[j] & mask;
+			while (_used[i])
+				i = (i + 1) & mask;
+			_entries[i] = oldEntries[j];
+			_hashes[i] = oldHashes[j];
+			_used[i] = true;
+		}
+		delete [] oldEntries;
+		delete [] oldHashes;
+		delete [] oldUsed;
+	}
+
+	Entry* _entries;
+	unsigned int* _hashes;
+	bool* _used;
+	int _capacity;
+	int _size;
+	H _hash;
+	E _equal;
+
+	friend class iterator;
+};
+
+#endif
+
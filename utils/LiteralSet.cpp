@@ -0,0 +1,341 @@
+#include <LiteralSet.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdlib.h>
+
+/*
+ * Constructor. Creates an empty set.
+ */
+LiteralSet::LiteralSet()
+: _maxId(-1)
+, _built(false)
+, _classCount(0)
+{
+	memset(_classes, 0, sizeof(_classes));
+}
+
+/*
+ * Destructor
+ */
+LiteralSet::~LiteralSet()
+{
+
+}
+
+/*
+ * add a literal to the set
+ * @param literal the literal string, ignored if empty
+ * @param id the id reported by scan() when the literal occurs
+ */
+void LiteralSet::add(const String& literal, int id)
+{
+	if (literal.length() == 0 || id < 0)
+		return;
+	_literals.push_back(literal);
+	_ids.push_back(id);
+	if (id > _maxId)
+		_maxId = id;
+	_built = false;
+}
+
+/*
+ * remove all of the literals
+ */
+void LiteralSet::clear()
+{
+	_literals.clear();
+	_ids.clear();
+	_delta.clear();
+	_outputs.clear();
+	_maxId = -1;
+	_built = false;
+}
+
+/*
+ * get the number of literals in the set
+ * @return literal count
+ */
+int LiteralSet::size() const
+{
+	return _literals.size();
+}
+
+/*
+ * find the literals that occur in some text
+ * @param text the text to scan
+ * @param length the number of bytes of text
+ * @param found set to true at the id of every literal found, false for
+ * 	  every other id.
+ */
+void LiteralSet::scan(const char* text, int length, std::vector< bool >& found)
+{
+	found.assign(_maxId + 1, false);
+	if (_literals.empty() || !text)
+		return;
+	if (!_built)
+		build();
+	int state = 0;
+	for (int i = 0; i < length; i++)
+	{
+		state = _delta[state * _classCount +
+			_classes[(unsigned char)text[i]]];
+		const std::vector< int >& out = _outputs[state];
+		int size = out.size();
+		for (int j = 0; j < size; j++)
+			found[out[j]] = true;
+	}
+}
+
+/*
+ * get the trie child of a node while the trie is being built
+ * @return child node or -1 if there isn't one
+ */
+int LiteralSet::child(int node, unsigned char c) const
+{
+	return _delta[node * _classCount + _classes[c]];
+}
+
+/*
+ * build the automaton: a trie of the literals with the failure links folded
+ * into a full transition table over byte classes.
+ */
+void LiteralSet::build()
+{
+	// bytes that aren't in any literal all behave the same
+	memset(_classes, 0, sizeof(_classes));
+	_classCount = 1;
+	int count = _literals.size();
+	int i;
+	for (i = 0; i < count; i++)
+	{
+		const char* lit = _literals[i];
+		for (int j = 0; lit[j]; j++)
+			if (_classes[(unsigned char)lit[j]] == 0)
+				_classes[(unsigned char)lit[j]] = _classCount++;
+	}
+
+	// the trie
+	_delta.assign(_classCount, -1);
+	_outputs.clear();
+	_outputs.resize(1);
+	for (i = 0; i < count; i++)
+	{
+		const char* lit = _literals[i];
+		int node = 0;
+		for (int j = 0; lit[j]; j++)
+		{
+			int next = child(node, (unsigned char)lit[j]);
+			if (next < 0)
+			{
+				next = _outputs.size();
+				_outputs.resize(next + 1);
+				_delta.resize(_delta.size() + _classCount, -1);
+				_delta[node * _classCount +
+					_classes[(unsigned char)lit[j]]] = next;
+			}
+			node = next;
+		}
+		_outputs[node].push_back(_ids[i]);
+	}
+
+	// breadth first over the trie filling in the failure transitions
+	int nodes = _outputs.size();
+	std::vector< int > fail(nodes, 0);
+	std::vector< int > queue;
+	queue.reserve(nodes);
+	int c;
+	for (c = 0; c < _classCount; c++)
+	{
+		int next = _delta[c];
+		if (next < 0)
+			_delta[c] = 0;
+		else
+		{
+			fail[next] = 0;
+			queue.push_back(next);
+		}
+	}
+	for (unsigned int head = 0; head < queue.size(); head++)
+	{
+		int node = queue[head];
+		const std::vector< int >& inherited = _outputs[fail[node]];
+		_outputs[node].insert(_outputs[node].end(), inherited.begin(),
+				inherited.end());
+		for (c = 0; c < _classCount; c++)
+		{
+			int next = _delta[node * _classCount + c];
+			int fallback = _delta[fail[node] * _classCount + c];
+			if (next < 0)
+				_delta[node * _classCount + c] = fallback;
+			else
+			{
+				fail[next] = fallback;
+				queue.push_back(next);
+			}
+		}
+	}
+	_built = true;
+}
+
+/*
+ * skip over a bracket expression
+ * @param p points at the opening [
+ * @return pointer just past the closing ], or NULL if it isn't closed
+ */
+static const char* skipBracket(const char* p)
+{
+	p++;
+	if (*p == '^')
+		p++;
+	if (*p == ']')
+		p++;
+	while (*p && *p != ']')
+	{
+		if (*p == '[' && (p[1] == ':' || p[1] == '.' || p[1] == '='))
+		{
+			p = strchr(p + 2, ']');
+			if (!p)
+				return NULL;
+		}
+		p++;
+	}
+	return *p ? p + 1 : NULL;
+}
+
+/*
+ * skip over a parenthesised group, including any groups inside it
+ * @param p points at the opening (
+ * @return pointer just past the closing ), or NULL if it isn't closed
+ */
+static const char* skipGroup(const char* p)
+{
+	int depth = 0;
+	while (*p)
+	{
+		if (*p == '\\' && p[1])
+			p += 2;
+		else if (*p == '[')
+		{
+			p = skipBracket(p);
+			if (!p)
+				return NULL;
+		}
+		else
+		{
+			if (*p == '(')
+				depth++;
+			else if (*p == ')' && --depth == 0)
+				return p + 1;
+			p++;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * work out a literal string that has to be in any text a regular expression
+ * (POSIX extended, case sensitive) matches. only the top level of the
+ * expression is looked at and the longest run of plain characters is used.
+ * @param regex the regular expression
+ * @param literal set to the required literal
+ * @return true if a literal was found, false if there is no simple one.
+ */
+bool LiteralSet::requiredLiteral(const char* regex, String& literal)
+{
+	literal = "";
+	if (!regex)
+		return false;
+
+	// alternatives at the top level have no single required literal
+	const char* p = regex;
+	while (*p)
+	{
+		if (*p == '\\' && p[1])
+			p += 2;
+		else if (*p == '[')
+			p = skipBracket(p);
+		else if (*p == '(')
+			p = skipGroup(p);
+		else if (*p == '|')
+			return false;
+		else
+			p++;
+		if (!p)
+			return false;
+	}
+
+	char best[256];
+	char run[256];
+	int bestLen = 0;
+	int runLen = 0;
+	p = regex;
+	while (*p)
+	{
+		char c = '\0';
+		bool plain = false;
+		if (*p == '\\')
+		{
+			// escaped punctuation is literal, the rest means something
+			c = p[1];
+			if (!c)
+				break;
+			plain = !isalnum((unsigned char)c) && !strchr("<>`'", c);
+			p += 2;
+		}
+		else if (*p == '[')
+			p = skipBracket(p);
+		else if (*p == '(')
+			p = skipGroup(p);
+		else if (strchr(".^$*+?{}|)", *p))
+			p++;
+		else
+		{
+			plain = true;
+			c = *p++;
+		}
+
+		// does a quantifier follow the atom?
+		int min = 1;
+		bool repeated = false;
+		while (*p == '*' || *p == '+' || *p == '?' ||
+				(*p == '{' && (isdigit((unsigned char)p[1]) ||
+						p[1] == ',')))
+		{
+			repeated = true;
+			if (*p == '*' || *p == '?')
+				min = 0;
+			else if (*p == '{')
+			{
+				if (atoi(p + 1) == 0)
+					min = 0;
+				while (*p && *p != '}')
+					p++;
+			}
+			if (*p)
+				p++;
+		}
+
+		if (plain && min > 0)
+			run[runLen++] = c;
+		if (!plain || repeated || runLen == (int)sizeof(run) - 1)
+		{
+			if (runLen > bestLen)
+			{
+				memcpy(best, run, runLen);
+				bestLen = runLen;
+			}
+			runLen = 0;
+		}
+	}
+	if (runLen > bestLen)
+	{
+		memcpy(best, run, runLen);
+		bestLen = runLen;
+	}
+	if (bestLen == 0)
+		return false;
+	best[bestLen] = '\0';
+	literal = best;
+	return true;
+}
+
@@ -0,0 +1,54 @@
+/*
+ * LiteralSet.h : Aho-Corasick search for many literal strings at once
+ */
+
+#ifndef BMLITERALSET_H
+#define BMLITERALSET_H
+
+#include <vector>
+#include <bString.h>
+
+/*
+ * A set of literal strings searched for in a single pass over the text
+ * (Aho-Corasick). Each literal carries an id and a scan reports the ids of
+ * all the literals that occur in the text.
+ *
+ * The automaton is built on the first scan after a change, so scan() must
+ * not be called from two threads at the same time.
+ */
+class LiteralSet
+{
+public:
+	LiteralSet();
+	virtual ~LiteralSet();
+
+	// building
+	void add(const String& literal, int id);
+	void clear();
+	int size() const;
+
+	// matching
+	void scan(const char* text, int length, std::vector< bool >& found);
+
+	// utility
+	static bool requiredLiteral(const char* regex, String& literal);
+
+private:
+	void build();
+	int child(int node, unsigned char c) const;
+
+	// the literals as added
+	std::vector< String > _literals;
+	std::vector< int > _ids;
+	int _maxId;
+
+	// automaton
+	bool _built;
+	unsigned char _classes[256];
+	int _classCount;
+	std::vector< int > _delta;
+	std::vector< std::vector< int > > _outputs;
+};
+
+#endif
+
@@ -0,0 +1,162 @@
+#include <MappedFile.h>
+
+#ifndef WIN32
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <windows.h>
+#endif
+
+/*
+ * Constructor. Nothing is mapped until open() is called.
+ */
+MappedFile::MappedFile()
+: _data(NULL)
+, _size(0)
+, _open(false)
+#ifdef WIN32
+, _file(NULL)
+, _mapping(NULL)
+#endif
+{
+
+}
+
+/*
+ * Destructor. Unmaps the file.
+ */
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+/*
+ * map a file, unmapping any file mapped before
+ * @param filename the file to map
+ * @return true if the file could be mapped (or is empty), false otherwise
+ */
+bool MappedFile::open(const String& filename)
+{
+	close();
+#ifndef WIN32
+	int fd = ::open((const char*)filename, O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size > 0x7fffffff)
+	{
+		::close(fd);
+		return false;
+	}
+	_size = info.st_size;
+	if (_size > 0)
+	{
+		void* data = mmap(NULL, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED)
+		{
+			::close(fd);
+			_size = 0;
+			return false;
+		}
+		_data = (const char*)data;
+	}
+	// the mapping keeps the file, the descriptor isn't needed
+	::close(fd);
+#else
+	HANDLE file = CreateFile((const char*)filename, GENERIC_READ,
+			FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	DWORD high = 0;
+	DWORD low = GetFileSize(file, &high);
+	if ((low == INVALID_FILE_SIZE && GetLastError() != NO_ERROR) ||
+			high != 0 || low > 0x7fffffff)
+	{
+		CloseHandle(file);
+		return false;
+	}
+	_size = low;
+	if (_size > 0)
+	{
+		HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY,
+				0, 0, NULL);
+		if (!mapping)
+		{
+			CloseHandle(file);
+			_size = 0;
+			return false;
+		}
+		_data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ,
+				0, 0, 0);
+		if (!_data)
+		{
+			CloseHandle(mapping);
+			CloseHandle(file);
+			_size = 0;
+			return false;
+		}
+		_mapping = mapping;
+	}
+	_file = file;
+#endif
+	_open = true;
+	return true;
+}
+
+/*
+ * unmap the file. any pointers into it are no good after this.
+ */
+void MappedFile::close()
+{
+	if (!_open)
+		return;
+#ifndef WIN32
+	if (_data)
+		munmap((void*)_data, _size);
+#else
+	if (_data)
+		UnmapViewOfFile(_data);
+	if (_mapping)
+		CloseHandle((HANDLE)_mapping);
+	if (_file)
+		CloseHandle((HANDLE)_file);
+	_mapping = NULL;
+	_file = NULL;
+#endif
+	_data = NULL;
+	_size = 0;
+	_open = false;
+}
+
+/*
+ * check if a file is mapped
+ * @return true or false
+ */
+bool MappedFile::isOpen() const
+{
+	return _open;
+}
+
+/*
+ * get the contents of the file. they are not NULL terminated.
+ * @return the first byte of the file, NULL if nothing is mapped or the file
+ * 	   is empty
+ */
+const char* MappedFile::getData() const
+{
+	return _data;
+}
+
+/*
+ * get the size of the mapped file
+ * @return size in bytes
+ */
+int MappedFile::size() const
+{
+	return _size;
+}
+
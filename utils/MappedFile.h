@@ -0,0 +1,50 @@
+/*
+ * MappedFile.h : read only view of a whole file through the page cache
+ */
+
+#ifndef BMMAPPEDFILE_H
+#define BMMAPPEDFILE_H
+
+#include <bString.h>
+
+/*
+ * Maps a file into memory read only (mmap, or CreateFileMapping on Windows).
+ * Nothing is read up front, the pages come in as they are touched and the
+ * system can drop them again whenever it likes since they are clean, so an
+ * idle mapping costs next to nothing.
+ *
+ * The mapping shows the file as it was when it was opened. Appending to the
+ * file afterwards is fine, truncating it while mapped is not: touching the
+ * pages that went would crash. Close the mapping before rewriting the file.
+ * Empty files open fine but have no data.
+ */
+class MappedFile
+{
+public:
+	MappedFile();
+	virtual ~MappedFile();
+
+	bool open(const String& filename);
+	void close();
+
+	// information
+	bool isOpen() const;
+	const char* getData() const;
+	int size() const;
+
+private:
+	// not copyable, the mapping belongs to one object
+	MappedFile(const MappedFile& other);
+	MappedFile& operator=(const MappedFile& other);
+
+	const char* _data;
+	int _size;
+	bool _open;
+#ifdef WIN32
+	void* _file;
+	void* _mapping;
+#endif
+};
+
+#endif
+
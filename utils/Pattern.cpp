@@ -0,0 +1,134 @@
+#include <Pattern.h>
+#include <stdio.h>
+
+/*
+ * Default constructor. The pattern is not valid until compiled.
+ */
+Pattern::Pattern()
+: _valid(false)
+{
+
+}
+
+/*
+ * Constructor. Compiles the given regular expression straight away.
+ * @param regex the regular expression (POSIX extended)
+ * @param ignoreCase true for a case insensitive match
+ */
+Pattern::Pattern(const char* regex, bool ignoreCase)
+: _valid(false)
+{
+	compile(regex, ignoreCase);
+}
+
+/*
+ * Destructor
+ */
+Pattern::~Pattern()
+{
+	release();
+}
+
+/*
+ * free the compiled expression, if there is one
+ */
+void Pattern::release()
+{
+	if (_valid)
+		regfree(&_regex);
+	_valid = false;
+}
+
+/*
+ * compile a regular expression, replacing any previously compiled one.
+ * @param regex the regular expression (POSIX extended)
+ * @param ignoreCase true for a case insensitive match
+ * @return true if the expression compiled, false if it is not valid. the
+ * 	   reason is available through getError().
+ */
+bool Pattern::compile(const char* regex, bool ignoreCase)
+{
+	release();
+	_pattern = regex;
+	_error = "";
+	if (!regex || !*regex)
+	{
+		_error = "empty regular expression";
+		return false;
+	}
+	int flags = REG_EXTENDED;
+	if (ignoreCase)
+		flags |= REG_ICASE;
+	int error = regcomp(&_regex, regex, flags);
+	if (error != 0)
+	{
+		char buf[256];
+		regerror(error, &_regex, buf, sizeof(buf));
+		_error = buf;
+		return false;
+	}
+	_valid = true;
+	return true;
+}
+
+/*
+ * check if the pattern compiled properly
+ * @return true or false
+ */
+bool Pattern::isValid() const
+{
+	return _valid;
+}
+
+/*
+ * get the source of the regular expression
+ * @return regular expression string
+ */
+const String& Pattern::getPattern() const
+{
+	return _pattern;
+}
+
+/*
+ * get the reason the last compile failed
+ * @return error text, empty if there was no error
+ */
+const String& Pattern::getError() const
+{
+	return _error;
+}
+
+/*
+ * check if there is a match for the pattern anywhere in the text
+ * @param text the text to test
+ * @return true or false. always false for an invalid pattern.
+ */
+bool Pattern::matches(const char* text) const
+{
+	if (!_valid)
+		return false;
+	return regexec(&_regex, text ? text : "", 0, NULL, 0) == 0;
+}
+
+/*
+ * find the first match of the pattern in the text
+ * @param text the text to search
+ * @param start set to the index of the start of the match
+ * @param end set to the index just past the end of the match
+ * @param notBol true if the text is not the beginning of a line (^ will not
+ * 	  match at the start of text)
+ * @return true if there was a match, false otherwise.
+ */
+bool Pattern::find(const char* text, int& start, int& end, bool notBol) const
+{
+	if (!_valid)
+		return false;
+	regmatch_t pm;
+	if (regexec(&_regex, text ? text : "", 1, &pm,
+				notBol ? REG_NOTBOL : 0) != 0)
+		return false;
+	start = pm.rm_so;
+	end = pm.rm_eo;
+	return true;
+}
+
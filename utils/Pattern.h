@@ -0,0 +1,48 @@
+/*
+ * Pattern.h : compiled regular expression
+ */
+
+#ifndef BMPATTERN_H
+#define BMPATTERN_H
+
+#include <sys/types.h>
+#include <regex.h>
+#include <bString.h>
+
+/*
+ * A POSIX extended regular expression that is compiled once and can then be
+ * matched any number of times. Patterns are not copyable.
+ */
+class Pattern
+{
+public:
+	Pattern();
+	Pattern(const char* regex, bool ignoreCase = false);
+	virtual ~Pattern();
+
+	// compilation
+	bool compile(const char* regex, bool ignoreCase = false);
+	bool isValid() const;
+	const String& getPattern() const;
+	const String& getError() const;
+
+	// matching
+	bool matches(const char* text) const;
+	bool find(const char* text, int& start, int& end,
+			bool notBol = false) const;
+
+private:
+	// not copyable, regex_t can't be duplicated
+	Pattern(const Pattern& other);
+	Pattern& operator=(const Pattern& other);
+
+	void release();
+
+	regex_t _regex;
+	bool _valid;
+	String _pattern;
+	String _error;
+};
+
+#endif
+
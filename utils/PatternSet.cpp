@@ -0,0 +1,809 @@
+#include <PatternSet.h>
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <locale.h>
+
+// character class names usable in bracket expressions
+struct CharClass
+{
+	const char* name;
+	int (*test)(int);
+};
+
+static const CharClass charClasses[] = {
+	{ "alpha", isalpha },
+	{ "digit", isdigit },
+	{ "alnum", isalnum },
+	{ "upper", isupper },
+	{ "lower", islower },
+	{ "space", isspace },
+	{ "blank", isblank },
+	{ "punct", ispunct },
+	{ "print", isprint },
+	{ "graph", isgraph },
+	{ "cntrl", iscntrl },
+	{ "xdigit", isxdigit },
+	{ NULL, NULL }
+};
+
+/*
+ * check if a byte is in a character set
+ */
+static inline bool inSet(const unsigned int* bits, int c)
+{
+	return (bits[c >> 5] & (1u << (c & 31))) != 0;
+}
+
+/*
+ * add a byte to a character set
+ */
+static inline void addToSet(unsigned int* bits, int c)
+{
+	bits[c >> 5] |= (1u << (c & 31));
+}
+
+/*
+ * check if ranges in bracket expressions are plain byte ranges. in other
+ * locales regcomp() uses the collation order, which we can't copy.
+ */
+static bool byteRanges()
+{
+	const char* collate = setlocale(LC_COLLATE, NULL);
+	if (!collate)
+		return true;
+	return strcmp(collate, "C") == 0 || strcmp(collate, "POSIX") == 0;
+}
+
+/*
+ * Constructor. Creates an empty set that matches nothing.
+ */
+PatternSet::PatternSet()
+: _count(0)
+, _maxId(-1)
+, _built(false)
+, _classCount(0)
+, _start(-1)
+, _scanCount(0)
+, _generation(0)
+{
+	memset(_classes, 0, sizeof(_classes));
+	memset(_representatives, 0, sizeof(_representatives));
+}
+
+/*
+ * Destructor
+ */
+PatternSet::~PatternSet()
+{
+
+}
+
+/*
+ * add a regular expression to the set.
+ * @param regex the regular expression (POSIX extended)
+ * @param id the id reported by scan() when this pattern matches
+ * @return true if the pattern is now part of the set. false if the pattern
+ * 	   is invalid or uses something the set can't match exactly, the set
+ * 	   is unchanged in that case.
+ */
+bool PatternSet::add(const char* regex, int id)
+{
+	if (!regex || !*regex || id < 0)
+		return false;
+	// byte at a time matching is only right for single byte locales
+	if (MB_CUR_MAX > 1)
+		return false;
+
+	int oldStates = _states.size();
+	int oldSets = _sets.size();
+	_nodes.clear();
+	const char* p = regex;
+	int root = parseAlternate(p, 0);
+	Fragment frag;
+	if (root < 0 || *p != '\0' || !emit(root, frag))
+	{
+		_states.resize(oldStates);
+		_sets.resize(oldSets);
+		_nodes.clear();
+		return false;
+	}
+	_nodes.clear();
+	int match = newState(Match);
+	_states[match].id = id;
+	patch(frag.outs, match);
+	_starts.push_back(frag.start);
+	if (id > _maxId)
+		_maxId = id;
+	_count++;
+	flushDfa();
+	return true;
+}
+
+/*
+ * remove all of the patterns
+ */
+void PatternSet::clear()
+{
+	_states.clear();
+	_sets.clear();
+	_starts.clear();
+	_nodes.clear();
+	_marks.clear();
+	_count = 0;
+	_maxId = -1;
+	flushDfa();
+}
+
+/*
+ * get the number of patterns in the set
+ * @return pattern count
+ */
+int PatternSet::size() const
+{
+	return _count;
+}
+
+/*
+ * scan some text and find all of the patterns that match it.
+ * @param text the text to scan
+ * @param length the number of bytes of text
+ * @param matched set to true at the id of every matching pattern, false
+ * 	  for every other id.
+ */
+void PatternSet::scan(const char* text, int length,
+		std::vector< bool >& matched)
+{
+	matched.assign(_maxId + 1, false);
+	if (_count == 0)
+		return;
+	if (!_built)
+	{
+		buildClasses();
+		std::vector< int > stack(_starts);
+		std::vector< int > nfa;
+		closure(stack, false, false, _restart);
+		stack = _starts;
+		closure(stack, true, false, nfa);
+		_start = addDState(nfa);
+		_built = true;
+	}
+	if (!text)
+		length = 0;
+	_scanCount++;
+
+	int s = _start;
+	int i;
+	for (i = 0; i <= length; i++)
+	{
+		DState& state = _dstates[s];
+		if (state.scanned != _scanCount && !state.accepts.empty())
+		{
+			state.scanned = _scanCount;
+			int size = state.accepts.size();
+			for (int j = 0; j < size; j++)
+				matched[state.accepts[j]] = true;
+		}
+		if (i == length)
+			break;
+		int cls = _classes[(unsigned char)text[i]];
+		int next = _transitions[s * _classCount + cls];
+		if (next < 0)
+			next = step(s, cls);
+		s = next;
+	}
+
+	// anything waiting on a $
+	std::vector< int >& ids = _endIds;
+	endAccepts(s, length == 0, ids);
+	int size = ids.size();
+	for (i = 0; i < size; i++)
+		matched[ids[i]] = true;
+}
+
+/*
+ * alternation := concat ( '|' concat )*
+ */
+int PatternSet::parseAlternate(const char*& p, int depth)
+{
+	int first = parseConcat(p, depth);
+	if (first < 0 || *p != '|')
+		return first;
+	int node = newNode(Alternate);
+	_nodes[node].children.push_back(first);
+	while (*p == '|')
+	{
+		p++;
+		int next = parseConcat(p, depth);
+		if (next < 0)
+			return -1;
+		_nodes[node].children.push_back(next);
+	}
+	return node;
+}
+
+/*
+ * concat := repeat+
+ */
+int PatternSet::parseConcat(const char*& p, int depth)
+{
+	std::vector< int > children;
+	while (*p && *p != '|' && *p != ')')
+	{
+		int next = parseRepeat(p, depth);
+		if (next < 0)
+			return -1;
+		children.push_back(next);
+	}
+	// empty branches are left to regcomp()
+	if (children.empty())
+		return -1;
+	if (children.size() == 1)
+		return children[0];
+	int node = newNode(Concat);
+	_nodes[node].children = children;
+	return node;
+}
+
+/*
+ * repeat := atom ( '*' | '+' | '?' | '{' m [ ',' [ n ] ] '}' )*
+ */
+int PatternSet::parseRepeat(const char*& p, int depth)
+{
+	int atom = parseAtom(p, depth);
+	if (atom < 0)
+		return -1;
+	while (*p == '*' || *p == '+' || *p == '?' || *p == '{')
+	{
+		// regcomp() has its own ideas about repeated anchors
+		if (hasAnchor(atom))
+			return -1;
+		int min = 0;
+		int max = -1;
+		if (*p == '+')
+			min = 1;
+		else if (*p == '?')
+			max = 1;
+		else if (*p == '{')
+		{
+			p++;
+			if (!isdigit((unsigned char)*p))
+				return -1;
+			min = 0;
+			while (isdigit((unsigned char)*p) && min <= PATTERNSET_MAX_REPEAT)
+				min = min * 10 + (*p++ - '0');
+			max = min;
+			if (*p == ',')
+			{
+				p++;
+				max = -1;
+				if (isdigit((unsigned char)*p))
+				{
+					max = 0;
+					while (isdigit((unsigned char)*p) &&
+							max <= PATTERNSET_MAX_REPEAT)
+						max = max * 10 + (*p++ - '0');
+				}
+			}
+			if (*p != '}' || min > PATTERNSET_MAX_REPEAT ||
+					max > PATTERNSET_MAX_REPEAT ||
+					(max >= 0 && max < min))
+				return -1;
+		}
+		p++;
+		int node = newNode(Repeat);
+		_nodes[node].min = min;
+		_nodes[node].max = max;
+		_nodes[node].children.push_back(atom);
+		atom = node;
+	}
+	return atom;
+}
+
+/*
+ * check if there is a ^ or $ anywhere in a parse tree
+ */
+bool PatternSet::hasAnchor(int index) const
+{
+	const Node& node = _nodes[index];
+	if (node.type == BolNode || node.type == EolNode)
+		return true;
+	int size = node.children.size();
+	for (int i = 0; i < size; i++)
+		if (hasAnchor(node.children[i]))
+			return true;
+	return false;
+}
+
+/*
+ * atom := '(' alternation ')' | '[' bracket ']' | '.' | '^' | '$'
+ * 	 | '\' char | char
+ */
+int PatternSet::parseAtom(const char*& p, int depth)
+{
+	CharSet set;
+	memset(&set, 0, sizeof(set));
+	unsigned char c = (unsigned char)*p;
+	switch (c)
+	{
+	case '(':
+	{
+		if (depth > 100)
+			return -1;
+		p++;
+		int node = parseAlternate(p, depth + 1);
+		if (node < 0 || *p != ')')
+			return -1;
+		p++;
+		return node;
+	}
+	case '[':
+		p++;
+		if (!parseBracket(p, set))
+			return -1;
+		break;
+	case '.':
+		p++;
+		for (int i = 1; i < 256; i++)
+			addToSet(set.bits, i);
+		break;
+	case '^':
+		p++;
+		return newNode(BolNode);
+	case '$':
+		p++;
+		return newNode(EolNode);
+	case '*':
+	case '+':
+	case '?':
+	case '{':
+	case ')':
+	case '\0':
+		return -1;
+	case '\\':
+		p++;
+		c = (unsigned char)*p;
+		// back references and the GNU extras are left to regcomp()
+		if (c == '\0' || isalnum(c) || strchr("<>`'", c))
+			return -1;
+		p++;
+		addToSet(set.bits, c);
+		break;
+	default:
+		p++;
+		addToSet(set.bits, c);
+		break;
+	}
+	int node = newNode(Literal);
+	_nodes[node].set = newSet(set);
+	return node;
+}
+
+/*
+ * parse a bracket expression, p points just past the '['
+ */
+bool PatternSet::parseBracket(const char*& p, CharSet& set)
+{
+	bool negate = false;
+	if (*p == '^')
+	{
+		negate = true;
+		p++;
+	}
+	bool first = true;
+	for (;;)
+	{
+		unsigned char c = (unsigned char)*p;
+		if (c == '\0')
+			return false;
+		if (c == ']' && !first)
+		{
+			p++;
+			break;
+		}
+		first = false;
+		if (c == '[' && (p[1] == '.' || p[1] == '='))
+			return false;
+		if (c == '[' && p[1] == ':')
+		{
+			const char* end = strstr(p + 2, ":]");
+			if (!end)
+				return false;
+			int len = end - (p + 2);
+			int i;
+			for (i = 0; charClasses[i].name; i++)
+			{
+				if ((int)strlen(charClasses[i].name) == len &&
+						strncmp(charClasses[i].name,
+							p + 2, len) == 0)
+					break;
+			}
+			if (!charClasses[i].name)
+				return false;
+			for (int b = 1; b < 256; b++)
+				if (charClasses[i].test(b))
+					addToSet(set.bits, b);
+			p = end + 2;
+			if (*p == '-' && p[1] != ']')
+				return false;
+			continue;
+		}
+		p++;
+		if (*p == '-' && p[1] != ']' && p[1] != '\0')
+		{
+			unsigned char hi = (unsigned char)p[1];
+			if (hi == '[' || hi < c || !byteRanges())
+				return false;
+			p += 2;
+			for (int b = c; b <= hi; b++)
+				addToSet(set.bits, b);
+		}
+		else
+			addToSet(set.bits, c);
+	}
+	if (negate)
+	{
+		for (int i = 0; i < 8; i++)
+			set.bits[i] = ~set.bits[i];
+	}
+	set.bits[0] &= ~1u;
+	return true;
+}
+
+/*
+ * add a node to the parse tree
+ */
+int PatternSet::newNode(NodeType type)
+{
+	Node node;
+	node.type = type;
+	node.set = -1;
+	node.min = 0;
+	node.max = 0;
+	_nodes.push_back(node);
+	return _nodes.size() - 1;
+}
+
+/*
+ * add a character set to the NFA
+ */
+int PatternSet::newSet(const CharSet& set)
+{
+	_sets.push_back(set);
+	return _sets.size() - 1;
+}
+
+/*
+ * add a state to the NFA
+ */
+int PatternSet::newState(StateType type, int out, int out1)
+{
+	State state;
+	state.type = type;
+	state.out = out;
+	state.out1 = out1;
+	state.set = -1;
+	state.id = -1;
+	_states.push_back(state);
+	return _states.size() - 1;
+}
+
+/*
+ * point dangling exits of a fragment at a state. exits are encoded as
+ * state * 2 for out and state * 2 + 1 for out1.
+ */
+void PatternSet::patch(const std::vector< int >& outs, int target)
+{
+	int size = outs.size();
+	for (int i = 0; i < size; i++)
+	{
+		if (outs[i] & 1)
+			_states[outs[i] >> 1].out1 = target;
+		else
+			_states[outs[i] >> 1].out = target;
+	}
+}
+
+/*
+ * build the NFA for a parse tree node (Thompson construction)
+ * @return false if the NFA would get too big
+ */
+bool PatternSet::emit(int index, Fragment& frag)
+{
+	if ((int)_states.size() > PATTERNSET_MAX_NFA_STATES)
+		return false;
+	// copy, emitting children can move _nodes around
+	Node node = _nodes[index];
+	frag.outs.clear();
+	switch (node.type)
+	{
+	case Literal:
+		frag.start = newState(Byte);
+		_states[frag.start].set = node.set;
+		frag.outs.push_back(frag.start * 2);
+		return true;
+	case BolNode:
+		frag.start = newState(Bol);
+		frag.outs.push_back(frag.start * 2);
+		return true;
+	case EolNode:
+		frag.start = newState(Eol);
+		frag.outs.push_back(frag.start * 2);
+		return true;
+	case Concat:
+	{
+		int size = node.children.size();
+		for (int i = 0; i < size; i++)
+		{
+			Fragment next;
+			if (!emit(node.children[i], next))
+				return false;
+			if (i == 0)
+				frag.start = next.start;
+			else
+				patch(frag.outs, next.start);
+			frag.outs = next.outs;
+		}
+		return true;
+	}
+	case Alternate:
+	{
+		int size = node.children.size();
+		std::vector< int > starts;
+		for (int i = 0; i < size; i++)
+		{
+			Fragment next;
+			if (!emit(node.children[i], next))
+				return false;
+			starts.push_back(next.start);
+			frag.outs.insert(frag.outs.end(), next.outs.begin(),
+					next.outs.end());
+		}
+		frag.start = starts[size - 1];
+		for (int i = size - 2; i >= 0; i--)
+			frag.start = newState(Split, starts[i], frag.start);
+		return true;
+	}
+	case Repeat:
+	{
+		int child = node.children[0];
+		// an empty start so that there is always something to patch
+		frag.start = newState(Split);
+		frag.outs.push_back(frag.start * 2);
+		int i;
+		for (i = 0; i < node.min; i++)
+		{
+			Fragment next;
+			if (!emit(child, next))
+				return false;
+			if (node.max < 0 && i == node.min - 1)
+			{
+				// last required copy loops back on itself
+				int loop = newState(Split, next.start);
+				patch(next.outs, loop);
+				next.outs.clear();
+				next.outs.push_back(loop * 2 + 1);
+			}
+			patch(frag.outs, next.start);
+			frag.outs = next.outs;
+		}
+		if (node.max < 0 && node.min == 0)
+		{
+			Fragment next;
+			if (!emit(child, next))
+				return false;
+			int loop = newState(Split, next.start);
+			patch(next.outs, loop);
+			patch(frag.outs, loop);
+			frag.outs.clear();
+			frag.outs.push_back(loop * 2 + 1);
+		}
+		for (; i < node.max; i++)
+		{
+			Fragment next;
+			if (!emit(child, next))
+				return false;
+			int optional = newState(Split, next.start);
+			patch(frag.outs, optional);
+			frag.outs = next.outs;
+			frag.outs.push_back(optional * 2 + 1);
+		}
+		return true;
+	}
+	}
+	return false;
+}
+
+/*
+ * follow the empty transitions from the states on the stack. the result is
+ * sorted and holds the states that consume input, match states and end of
+ * line states still waiting for the end of the text.
+ * @param stack the states to start from, emptied on return.
+ * @param atStart true at the start of the text (^ can be passed)
+ * @param atEnd true at the end of the text ($ can be passed)
+ * @param result the closure
+ */
+void PatternSet::closure(std::vector< int >& stack, bool atStart, bool atEnd,
+		std::vector< int >& result)
+{
+	result.clear();
+	if (_marks.size() < _states.size())
+		_marks.resize(_states.size(), 0);
+	if (++_generation <= 0)
+	{
+		std::fill(_marks.begin(), _marks.end(), 0);
+		_generation = 1;
+	}
+	while (!stack.empty())
+	{
+		int s = stack.back();
+		stack.pop_back();
+		if (s < 0 || _marks[s] == _generation)
+			continue;
+		_marks[s] = _generation;
+		const State& state = _states[s];
+		switch (state.type)
+		{
+		case Byte:
+		case Match:
+			result.push_back(s);
+			break;
+		case Split:
+			stack.push_back(state.out1);
+			stack.push_back(state.out);
+			break;
+		case Bol:
+			if (atStart)
+				stack.push_back(state.out);
+			break;
+		case Eol:
+			result.push_back(s);
+			if (atEnd)
+				stack.push_back(state.out);
+			break;
+		}
+	}
+	std::sort(result.begin(), result.end());
+}
+
+/*
+ * find or add a DFA state for a set of NFA states
+ * @return the DFA state, -1 if the cache is full
+ */
+int PatternSet::addDState(std::vector< int >& nfa)
+{
+	std::map< std::vector< int >, int >::iterator iter;
+	iter = _dstateIndex.find(nfa);
+	if (iter != _dstateIndex.end())
+		return iter->second;
+	if ((int)_dstates.size() >= PATTERNSET_MAX_DFA_STATES)
+		return -1;
+	DState dstate;
+	dstate.nfa = nfa;
+	dstate.scanned = 0;
+	dstate.endDone = false;
+	int size = nfa.size();
+	for (int i = 0; i < size; i++)
+		if (_states[nfa[i]].type == Match)
+			dstate.accepts.push_back(_states[nfa[i]].id);
+	_dstates.push_back(dstate);
+	_transitions.resize(_transitions.size() + _classCount, -1);
+	int index = _dstates.size() - 1;
+	_dstateIndex[nfa] = index;
+	return index;
+}
+
+/*
+ * work out the DFA transition from a state on a byte class
+ * @return the next DFA state
+ */
+int PatternSet::step(int dstate, int cls)
+{
+	int c = _representatives[cls];
+	std::vector< int > stack;
+	const std::vector< int >& nfa = _dstates[dstate].nfa;
+	int size = nfa.size();
+	for (int i = 0; i < size; i++)
+	{
+		const State& state = _states[nfa[i]];
+		if (state.type == Byte && inSet(_sets[state.set].bits, c))
+			stack.push_back(state.out);
+	}
+	std::vector< int > moved;
+	closure(stack, false, false, moved);
+	// every position is a new chance for every pattern to start
+	std::vector< int > next;
+	std::set_union(moved.begin(), moved.end(), _restart.begin(),
+			_restart.end(), std::back_inserter(next));
+	int index = addDState(next);
+	if (index < 0)
+	{
+		// too many states, start the cache again
+		flushDfa();
+		stack = _starts;
+		std::vector< int > start;
+		closure(stack, true, false, start);
+		_start = addDState(start);
+		_built = true;
+		return addDState(next);
+	}
+	_transitions[dstate * _classCount + cls] = index;
+	return index;
+}
+
+/*
+ * find the patterns that match once the end of the text is reached
+ * @param dstate the DFA state at the end of the text
+ * @param atStart true if the text was empty
+ * @param ids set to the matching pattern ids
+ */
+void PatternSet::endAccepts(int dstate, bool atStart, std::vector< int >& ids)
+{
+	DState& state = _dstates[dstate];
+	if (state.endDone && !atStart)
+	{
+		ids = state.endAccepts;
+		return;
+	}
+	std::vector< int > stack;
+	int size = state.nfa.size();
+	for (int i = 0; i < size; i++)
+		if (_states[state.nfa[i]].type == Eol)
+			stack.push_back(_states[state.nfa[i]].out);
+	ids.clear();
+	if (!stack.empty())
+	{
+		std::vector< int > result;
+		closure(stack, atStart, true, result);
+		size = result.size();
+		for (int i = 0; i < size; i++)
+			if (_states[result[i]].type == Match)
+				ids.push_back(_states[result[i]].id);
+	}
+	if (!atStart)
+	{
+		state.endAccepts = ids;
+		state.endDone = true;
+	}
+}
+
+/*
+ * throw away the DFA, it gets built again on the next scan
+ */
+void PatternSet::flushDfa()
+{
+	_built = false;
+	_dstates.clear();
+	_transitions.clear();
+	_dstateIndex.clear();
+	_start = -1;
+}
+
+/*
+ * split the bytes into classes that every character set treats the same
+ * way, so the DFA only needs a transition per class rather than per byte.
+ */
+void PatternSet::buildClasses()
+{
+	memset(_classes, 0, sizeof(_classes));
+	_classCount = 1;
+	int size = _sets.size();
+	std::vector< int > remap;
+	for (int i = 0; i < size; i++)
+	{
+		remap.assign(_classCount * 2, -1);
+		int count = 0;
+		for (int b = 0; b < 256; b++)
+		{
+			int key = _classes[b] * 2 + (inSet(_sets[i].bits, b) ? 1 : 0);
+			if (remap[key] < 0)
+				remap[key] = count++;
+			_classes[b] = remap[key];
+		}
+		_classCount = count;
+	}
+	for (int b = 255; b >= 0; b--)
+		_representatives[_classes[b]] = b;
+}
+
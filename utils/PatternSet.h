@@ -0,0 +1,144 @@
+/*
+ * PatternSet.h : many regular expressions matched in a single pass
+ */
+
+#ifndef BMPATTERNSET_H
+#define BMPATTERNSET_H
+
+#include <vector>
+#include <map>
+
+// upper limits so that one silly pattern can't eat all the memory
+#define PATTERNSET_MAX_NFA_STATES (65536)
+#define PATTERNSET_MAX_DFA_STATES (2048)
+#define PATTERNSET_MAX_REPEAT (64)
+
+/*
+ * A set of POSIX extended regular expressions compiled into one automaton.
+ * The text is scanned once and the result is the set of ids of all the
+ * patterns that match somewhere in it, just as regexec() would report for
+ * each of them on its own.
+ *
+ * The NFA is built up as patterns are added. The DFA is built lazily from it
+ * while scanning and is thrown away when the set changes or grows too big.
+ * Not everything regcomp() understands is supported (back references, GNU
+ * escapes, collating elements, multibyte locales), add() refuses those and
+ * the caller has to match them some other way.
+ *
+ * scan() updates the DFA cache so it must not be called from two threads at
+ * the same time.
+ */
+class PatternSet
+{
+public:
+	PatternSet();
+	virtual ~PatternSet();
+
+	// building
+	bool add(const char* regex, int id);
+	void clear();
+	int size() const;
+
+	// matching
+	void scan(const char* text, int length, std::vector< bool >& matched);
+
+private:
+	// NFA state types
+	enum StateType { Byte = 0, Split, Bol, Eol, Match };
+
+	struct CharSet
+	{
+		unsigned int bits[8];
+	};
+
+	struct State
+	{
+		StateType type;
+		int out;
+		int out1;
+		int set;
+		int id;
+	};
+
+	struct DState
+	{
+		std::vector< int > nfa;
+		std::vector< int > accepts;
+		std::vector< int > endAccepts;
+		bool endDone;
+		int scanned;
+	};
+
+	// parse tree
+	enum NodeType { Literal = 0, Concat, Alternate, Repeat, BolNode,
+		EolNode };
+
+	struct Node
+	{
+		NodeType type;
+		int set;
+		int min;
+		int max;
+		std::vector< int > children;
+	};
+
+	struct Fragment
+	{
+		int start;
+		std::vector< int > outs;
+	};
+
+	// parsing
+	int parseAlternate(const char*& p, int depth);
+	int parseConcat(const char*& p, int depth);
+	int parseRepeat(const char*& p, int depth);
+	int parseAtom(const char*& p, int depth);
+	bool parseBracket(const char*& p, CharSet& set);
+	bool hasAnchor(int node) const;
+	int newNode(NodeType type);
+	int newSet(const CharSet& set);
+
+	// NFA construction
+	bool emit(int node, Fragment& frag);
+	int newState(StateType type, int out = -1, int out1 = -1);
+	void patch(const std::vector< int >& outs, int target);
+
+	// DFA construction
+	void closure(std::vector< int >& stack, bool atStart, bool atEnd,
+			std::vector< int >& result);
+	int addDState(std::vector< int >& nfa);
+	int step(int dstate, int cls);
+	void flushDfa();
+	void buildClasses();
+	void endAccepts(int dstate, bool atStart, std::vector< int >& ids);
+
+	// NFA
+	std::vector< State > _states;
+	std::vector< CharSet > _sets;
+	std::vector< int > _starts;
+	int _count;
+	int _maxId;
+
+	// parse tree of the pattern being added
+	std::vector< Node > _nodes;
+
+	// lazy DFA
+	bool _built;
+	unsigned char _classes[256];
+	unsigned char _representatives[256];
+	int _classCount;
+	std::vector< DState > _dstates;
+	std::vector< int > _transitions;
+	std::map< std::vector< int >, int > _dstateIndex;
+	std::vector< int > _restart;
+	int _start;
+	int _scanCount;
+	std::vector< int > _endIds;
+
+	// closure workspace
+	std::vector< int > _marks;
+	int _generation;
+};
+
+#endif
+
@@ -0,0 +1,308 @@
+#include <RegexCache.h>
+#include <string.h>
+#include <stddef.h>
+
+/*
+ * Constructor
+ * @param capacity the most expressions to keep compiled
+ */
+RegexCache::RegexCache(int capacity)
+: _capacity(capacity < 1 ? 1 : capacity)
+, _head(NULL)
+, _tail(NULL)
+, _hits(0)
+, _misses(0)
+, _evictions(0)
+{
+
+}
+
+/*
+ * Destructor. Expressions still acquired at this point are leaked rather
+ * than pulled from under their users.
+ */
+RegexCache::~RegexCache()
+{
+	clear();
+}
+
+/*
+ * get the cache shared by everything in the process
+ * @return the cache
+ */
+RegexCache& RegexCache::shared()
+{
+	static RegexCache cache;
+	return cache;
+}
+
+/*
+ * order keys by expression, then by flags
+ * @param k1 the first key
+ * @param k2 the second key
+ * @return true if k1 comes before k2
+ */
+bool RegexCache::ltkey::operator()(const Key& k1, const Key& k2) const
+{
+	int diff = strcmp(k1.regex, k2.regex);
+	if (diff != 0)
+		return diff < 0;
+	return k1.flags < k2.flags;
+}
+
+/*
+ * get a compiled regular expression, compiling it if it isn't in the cache.
+ * every successful acquire() must be matched by a release().
+ * @param regex the regular expression
+ * @param flags the regcomp() flags
+ * @return the compiled expression, or NULL if it doesn't compile
+ */
+const regex_t* RegexCache::acquire(const char* regex, int flags)
+{
+	if (!regex)
+		return NULL;
+	Key key;
+	key.regex = regex;
+	key.flags = flags;
+
+	_mutex.lock();
+	Entry* entry = NULL;
+	Entry* spare = NULL;
+	std::map< Key, Entry*, ltkey >::iterator iter = _entries.find(key);
+	if (iter != _entries.end())
+	{
+		entry = iter->second;
+		_hits++;
+		unlink(entry);
+		pushFront(entry);
+	}
+	else
+	{
+		_misses++;
+		// regcomp() can be slow, don't hold everyone else up for it
+		_mutex.unlock();
+		entry = new Entry;
+		char* copy = new char[strlen(regex) + 1];
+		strcpy(copy, regex);
+		entry->key.regex = copy;
+		entry->key.flags = flags;
+		entry->valid = regcomp(&entry->regex, regex, flags) == 0;
+		entry->cached = true;
+		entry->refs = 0;
+		entry->prev = NULL;
+		entry->next = NULL;
+		_mutex.lock();
+		// another thread may have compiled it meanwhile, use theirs
+		iter = _entries.find(key);
+		if (iter != _entries.end())
+		{
+			spare = entry;
+			entry = iter->second;
+			unlink(entry);
+			pushFront(entry);
+		}
+		else
+		{
+			_entries[entry->key] = entry;
+			pushFront(entry);
+			while ((int)_entries.size() > _capacity)
+			{
+				_evictions++;
+				evict(_tail);
+			}
+		}
+	}
+	// expressions that don't compile are cached too, so they fail quickly
+	const regex_t* result = NULL;
+	if (entry->valid)
+	{
+		entry->refs++;
+		result = &entry->regex;
+	}
+	_mutex.unlock();
+	if (spare)
+		destroy(spare);
+	return result;
+}
+
+/*
+ * give back an expression got from acquire()
+ * @param regex the compiled expression, NULL is ignored
+ */
+void RegexCache::release(const regex_t* regex)
+{
+	if (!regex)
+		return;
+	// the regex_t is inside its entry
+	Entry* entry = (Entry*)((char*)regex - offsetof(Entry, regex));
+	_mutex.lock();
+	entry->refs--;
+	if (entry->refs == 0 && !entry->cached)
+		destroy(entry);
+	_mutex.unlock();
+}
+
+/*
+ * throw away all of the cached expressions. ones still in use are freed
+ * when they are released.
+ */
+void RegexCache::clear()
+{
+	_mutex.lock();
+	while (_tail)
+		evict(_tail);
+	_mutex.unlock();
+}
+
+/*
+ * get the number of expressions in the cache
+ * @return expression count
+ */
+int RegexCache::size()
+{
+	_mutex.lock();
+	int size = _entries.size();
+	_mutex.unlock();
+	return size;
+}
+
+/*
+ * get the most expressions the cache will hold
+ * @return capacity
+ */
+int RegexCache::getCapacity() const
+{
+	return _capacity;
+}
+
+/*
+ * get the number of times an expression was already compiled
+ * @return hit count
+ */
+unsigned long RegexCache::getHits()
+{
+	_mutex.lock();
+	unsigned long hits = _hits;
+	_mutex.unlock();
+	return hits;
+}
+
+/*
+ * get the number of times an expression had to be compiled
+ * @return miss count
+ */
+unsigned long RegexCache::getMisses()
+{
+	_mutex.lock();
+	unsigned long misses = _misses;
+	_mutex.unlock();
+	return misses;
+}
+
+/*
+ * get the number of expressions thrown out to make room
+ * @return eviction count
+ */
+unsigned long RegexCache::getEvictions()
+{
+	_mutex.lock();
+	unsigned long evictions = _evictions;
+	_mutex.unlock();
+	return evictions;
+}
+
+/*
+ * take an entry out of the recently used list
+ * @param entry the entry
+ */
+void RegexCache::unlink(Entry* entry)
+{
+	if (entry->prev)
+		entry->prev->next = entry->next;
+	else
+		_head = entry->next;
+	if (entry->next)
+		entry->next->prev = entry->prev;
+	else
+		_tail = entry->prev;
+	entry->prev = NULL;
+	entry->next = NULL;
+}
+
+/*
+ * put an entry at the front of the recently used list
+ * @param entry the entry
+ */
+void RegexCache::pushFront(Entry* entry)
+{
+	entry->prev = NULL;
+	entry->next = _head;
+	if (_head)
+		_head->prev = entry;
+	_head = entry;
+	if (!_tail)
+		_tail = entry;
+}
+
+/*
+ * remove an entry from the cache, freeing it unless it is in use
+ * @param entry the entry
+ */
+void RegexCache::evict(Entry* entry)
+{
+	unlink(entry);
+	_entries.erase(entry->key);
+	entry->cached = false;
+	if (entry->refs == 0)
+		destroy(entry);
+}
+
+/*
+ * free an entry and its compiled expression
+ * @param entry the entry
+ */
+void RegexCache::destroy(Entry* entry)
+{
+	if (entry->valid)
+		regfree(&entry->regex);
+	delete [] (char*)entry->key.regex;
+	delete entry;
+}
+
+/*
+ * Constructor. Borrows the compiled expression from the shared cache.
+ * @param regex the regular expression
+ * @param flags the regcomp() flags
+ */
+CachedRegex::CachedRegex(const char* regex, int flags)
+: _regex(RegexCache::shared().acquire(regex, flags))
+{
+
+}
+
+/*
+ * Destructor. Gives the expression back to the cache.
+ */
+CachedRegex::~CachedRegex()
+{
+	RegexCache::shared().release(_regex);
+}
+
+/*
+ * check if the expression compiled
+ * @return true or false
+ */
+bool CachedRegex::isValid() const
+{
+	return _regex != NULL;
+}
+
+/*
+ * get the compiled expression
+ * @return the expression, NULL if it didn't compile
+ */
+const regex_t* CachedRegex::get() const
+{
+	return _regex;
+}
+
@@ -0,0 +1,114 @@
+/*
+ * RegexCache.h : shared cache of compiled regular expressions
+ */
+
+#ifndef BMREGEXCACHE_H
+#define BMREGEXCACHE_H
+
+#include <sys/types.h>
+#include <regex.h>
+#include <map>
+#include <bString.h>
+#include <Thread.h>
+
+// number of compiled expressions kept by the shared cache
+#define REGEXCACHE_SIZE (64)
+
+/*
+ * A bounded cache of compiled regular expressions keyed by the expression
+ * and the regcomp() flags. When it is full the least recently used
+ * expression is thrown out. Entries are reference counted, so one that is
+ * still in use when it is thrown out is only freed when it is released.
+ *
+ * All of the methods are thread safe. Use CachedRegex rather than calling
+ * acquire() and release() directly.
+ */
+class RegexCache
+{
+public:
+	RegexCache(int capacity = REGEXCACHE_SIZE);
+	virtual ~RegexCache();
+
+	// use
+	const regex_t* acquire(const char* regex, int flags);
+	void release(const regex_t* regex);
+	void clear();
+
+	// statistics
+	int size();
+	int getCapacity() const;
+	unsigned long getHits();
+	unsigned long getMisses();
+	unsigned long getEvictions();
+
+	// the cache used by String
+	static RegexCache& shared();
+
+private:
+	// not copyable
+	RegexCache(const RegexCache& other);
+	RegexCache& operator=(const RegexCache& other);
+
+	// an expression and its flags, the pattern is not copied
+	struct Key
+	{
+		const char* regex;
+		int flags;
+	};
+
+	struct ltkey
+	{
+		bool operator()(const Key& k1, const Key& k2) const;
+	};
+
+	struct Entry
+	{
+		// the map key, pointing at the entry's own copy of the pattern
+		Key key;
+		regex_t regex;
+		bool valid;
+		bool cached;
+		int refs;
+		Entry* prev;
+		Entry* next;
+	};
+
+	void unlink(Entry* entry);
+	void pushFront(Entry* entry);
+	void evict(Entry* entry);
+	static void destroy(Entry* entry);
+
+	int _capacity;
+	std::map< Key, Entry*, ltkey > _entries;
+	// most recently used first
+	Entry* _head;
+	Entry* _tail;
+	unsigned long _hits;
+	unsigned long _misses;
+	unsigned long _evictions;
+	Mutex _mutex;
+};
+
+/*
+ * A compiled regular expression borrowed from the shared cache for as long
+ * as the object lives.
+ */
+class CachedRegex
+{
+public:
+	CachedRegex(const char* regex, int flags);
+	virtual ~CachedRegex();
+
+	bool isValid() const;
+	const regex_t* get() const;
+
+private:
+	// not copyable
+	CachedRegex(const CachedRegex& other);
+	CachedRegex& operator=(const CachedRegex& other);
+
+	const regex_t* _regex;
+};
+
+#endif
+
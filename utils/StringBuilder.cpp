@@ -0,0 +1,167 @@
+#include <StringBuilder.h>
+#include <string.h>
+
+/*
+ * Constructor
+ * @param capacity the number of characters to make room for up front
+ */
+StringBuilder::StringBuilder(int capacity)
+: _buffer(NULL)
+, _alloc(0)
+, _length(0)
+{
+	if (capacity > 0)
+		reserve(capacity);
+}
+
+/*
+ * Destructor
+ */
+StringBuilder::~StringBuilder()
+{
+	delete [] _buffer;
+}
+
+/*
+ * make sure there is room for a number of characters without growing again
+ * @param capacity the number of characters, not counting the terminator
+ */
+void StringBuilder::reserve(int capacity)
+{
+	if (capacity + 1 <= _alloc)
+		return;
+	int size = _alloc ? _alloc : 16;
+	while (size < capacity + 1)
+		size <<= 1;
+	char* temp = new char[size];
+	if (_length > 0)
+		memcpy(temp, _buffer, _length);
+	temp[_length] = '\0';
+	delete [] _buffer;
+	_buffer = temp;
+	_alloc = size;
+}
+
+/*
+ * add some text to the end
+ * @param text the text, need not be NULL terminated
+ * @param length the number of characters of text to add
+ * @return this
+ */
+StringBuilder& StringBuilder::append(const char* text, int length)
+{
+	if (!text || length <= 0)
+		return *this;
+	if (_length + length + 1 > _alloc)
+	{
+		// text may point into our own buffer
+		if (text >= _buffer && text < _buffer + _alloc)
+		{
+			int offset = text - _buffer;
+			reserve(_length + length);
+			text = _buffer + offset;
+		}
+		else
+			reserve(_length + length);
+	}
+	memmove(_buffer + _length, text, length);
+	_length += length;
+	_buffer[_length] = '\0';
+	return *this;
+}
+
+/*
+ * add some text to the end
+ * @param text NULL terminated text
+ * @return this
+ */
+StringBuilder& StringBuilder::append(const char* text)
+{
+	if (!text)
+		return *this;
+	return append(text, strlen(text));
+}
+
+/*
+ * add a string to the end
+ * @param text the string
+ * @return this
+ */
+StringBuilder& StringBuilder::append(const String& text)
+{
+	return append(text, text.length());
+}
+
+/*
+ * add a character to the end
+ * @param c the character, '\0' is ignored
+ * @return this
+ */
+StringBuilder& StringBuilder::append(char c)
+{
+	if (c == '\0')
+		return *this;
+	return append(&c, 1);
+}
+
+/*
+ * empty the builder, keeping its buffer
+ */
+void StringBuilder::clear()
+{
+	_length = 0;
+	if (_buffer)
+		_buffer[0] = '\0';
+}
+
+/*
+ * get the number of characters built so far
+ * @return length
+ */
+int StringBuilder::length() const
+{
+	return _length;
+}
+
+/*
+ * get the text built so far
+ * @return NULL terminated text, good until the builder next changes
+ */
+const char* StringBuilder::getBuffer() const
+{
+	return _buffer ? _buffer : "";
+}
+
+/*
+ * get a copy of the text built so far
+ * @return the text
+ */
+String StringBuilder::toString() const
+{
+	return String(getBuffer());
+}
+
+/*
+ * hand the text built so far over to a String, replacing its contents. long
+ * text is handed over without copying, leaving the builder without a buffer.
+ * either way the builder is empty afterwards.
+ * @param target the string
+ */
+void StringBuilder::moveTo(String& target)
+{
+	if (_length < STRING_SMALL_SIZE)
+	{
+		target = getBuffer();
+		clear();
+		return;
+	}
+	target.release();
+	target._string = _buffer;
+	target._alloc = _alloc;
+	target._length = _length;
+	target._hash = 0;
+	_buffer = NULL;
+	_alloc = 0;
+	_length = 0;
+}
+
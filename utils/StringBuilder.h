@@ -0,0 +1,49 @@
+/*
+ * StringBuilder.h : growable buffer for putting strings together
+ */
+
+#ifndef BMSTRINGBUILDER_H
+#define BMSTRINGBUILDER_H
+
+#include <bString.h>
+
+/*
+ * Collects pieces of text into one buffer, growing it as needed (doubling,
+ * so appending is amortised constant time). The finished text can be handed
+ * to a String without copying it. clear() keeps the buffer so a builder can
+ * be reused.
+ */
+class StringBuilder
+{
+public:
+	StringBuilder(int capacity = 0);
+	virtual ~StringBuilder();
+
+	// building
+	StringBuilder& append(const char* text, int length);
+	StringBuilder& append(const char* text);
+	StringBuilder& append(const String& text);
+	StringBuilder& append(char c);
+	void reserve(int capacity);
+	void clear();
+
+	// information
+	int length() const;
+	const char* getBuffer() const;
+
+	// results
+	String toString() const;
+	void moveTo(String& target);
+
+private:
+	// not copyable
+	StringBuilder(const StringBuilder& other);
+	StringBuilder& operator=(const StringBuilder& other);
+
+	char* _buffer;
+	int _alloc;
+	int _length;
+};
+
+#endif
+
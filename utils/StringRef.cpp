@@ -0,0 +1,245 @@
+#include <StringRef.h>
+#include <StringBuilder.h>
+#include <string.h>
+#include <ctype.h>
+
+/*
+ * Default constructor. An empty view.
+ */
+StringRef::StringRef()
+: _data(NULL)
+, _length(0)
+, _terminated(true)
+{
+
+}
+
+/*
+ * Constructor. Views a NULL terminated character array.
+ * @param value the characters, may be NULL
+ */
+StringRef::StringRef(const char* value)
+: _data(value)
+, _length(value ? strlen(value) : 0)
+, _terminated(true)
+{
+
+}
+
+/*
+ * Constructor. Views a number of characters that need not be NULL
+ * terminated.
+ * @param value the characters
+ * @param length how many of them to look at
+ */
+StringRef::StringRef(const char* value, int length)
+: _data(value)
+, _length(value && length > 0 ? length : 0)
+, _terminated(_length == 0)
+{
+
+}
+
+/*
+ * Constructor. Views the current contents of a String, which must not be
+ * changed while the view is in use.
+ * @param value the String
+ */
+StringRef::StringRef(const String& value)
+: _data(value)
+, _length(value.length())
+, _terminated(true)
+{
+
+}
+
+/*
+ * get the first character of the view
+ * @return pointer to the characters, NULL if the view is empty
+ */
+const char* StringRef::getBuffer() const
+{
+	return _length ? _data : NULL;
+}
+
+/*
+ * get the length of the view
+ * @return number of characters
+ */
+int StringRef::length() const
+{
+	return _length;
+}
+
+/*
+ * check if the view has any characters
+ * @return true or false
+ */
+bool StringRef::isEmpty() const
+{
+	return _length == 0;
+}
+
+/*
+ * check if the character after the view is known to be a NULL
+ * @return true or false
+ */
+bool StringRef::isTerminated() const
+{
+	return _terminated;
+}
+
+/*
+ * compare with a NULL terminated character array
+ * @param other the characters to compare with. NULL is the same as ""
+ * @return true if they are the same
+ */
+bool StringRef::equals(const char* other) const
+{
+	int len = other ? strlen(other) : 0;
+	if (len != _length)
+		return false;
+	return len == 0 || memcmp(_data, other, len) == 0;
+}
+
+/*
+ * compare with another view
+ * @param other the view to compare with
+ * @return true if they are the same
+ */
+bool StringRef::equals(const StringRef& other) const
+{
+	if (other._length != _length)
+		return false;
+	return _length == 0 || memcmp(_data, other._data, _length) == 0;
+}
+
+/*
+ * check if the view starts with some text
+ * @param prefix the text to look for
+ * @return true or false. false for an empty prefix, as with String.
+ */
+bool StringRef::startsWith(const char* prefix) const
+{
+	if (!prefix || !*prefix)
+		return false;
+	int len = strlen(prefix);
+	if (len > _length)
+		return false;
+	return memcmp(_data, prefix, len) == 0;
+}
+
+/*
+ * hash the characters in view
+ * @return the same hash as a String with the same contents
+ */
+unsigned int StringRef::hash() const
+{
+	return String::hash(_data, _length);
+}
+
+/*
+ * get the character at a given index
+ * @param index the index, from 0 to length() - 1
+ * @return the character, or 0 if the index is out of range
+ */
+char StringRef::charAt(int index) const
+{
+	if (index >= 0 && index < _length)
+		return _data[index];
+	return 0;
+}
+
+/*
+ * get the character at a given index
+ * @param index the index, from 0 to length() - 1
+ * @return the character, or 0 if the index is out of range
+ */
+char StringRef::operator[](int index) const
+{
+	return charAt(index);
+}
+
+/*
+ * find the first occurrence of a character
+ * @param ch the character to look for
+ * @param fromIndex where to start looking
+ * @return the index of the character, -1 if it isn't there
+ */
+int StringRef::indexOf(char ch, int fromIndex) const
+{
+	if (fromIndex < 0)
+		fromIndex = 0;
+	if (fromIndex >= _length)
+		return -1;
+	const char* found = (const char*)memchr(_data + fromIndex, ch,
+			_length - fromIndex);
+	return found ? found - _data : -1;
+}
+
+/*
+ * get a view of part of this one
+ * @param beginning index of the first character
+ * @param end index just past the last character, -1 for the end of the view
+ * @return the part of the view, clipped to its bounds
+ */
+StringRef StringRef::substring(int beginning, int end) const
+{
+	if (end < 0 || end > _length)
+		end = _length;
+	if (beginning < 0)
+		beginning = 0;
+	if (beginning >= end)
+		return StringRef();
+	StringRef result(_data + beginning, end - beginning);
+	result._terminated = _terminated && end == _length;
+	return result;
+}
+
+/*
+ * get a view without the white space at either end
+ * @return the trimmed view
+ */
+StringRef StringRef::trimmed() const
+{
+	int beginning = 0;
+	int end = _length;
+	while (beginning < end && isspace((unsigned char)_data[beginning]))
+		beginning++;
+	while (end > beginning && isspace((unsigned char)_data[end - 1]))
+		end--;
+	return substring(beginning, end);
+}
+
+/*
+ * copy the characters into a String of their own
+ * @return the new String
+ */
+String StringRef::toString() const
+{
+	String result;
+	if (_length == 0)
+		return result;
+	StringBuilder builder(_length);
+	builder.append(_data, _length);
+	builder.moveTo(result);
+	return result;
+}
+
+/*
+ * get the characters as a NULL terminated array for C code. only views that
+ * don't end in a NULL are copied.
+ * @param storage where to put the copy if one is needed, it has to live as
+ * 	  long as the returned pointer is used
+ * @return the characters, NULL if the view is empty
+ */
+const char* StringRef::toCString(String& storage) const
+{
+	if (_length == 0)
+		return NULL;
+	if (_terminated)
+		return _data;
+	storage = toString();
+	return storage;
+}
+
@@ -0,0 +1,75 @@
+/*
+ * StringRef.h : read only view of somebody else's characters
+ */
+
+#ifndef BMSTRINGREF_H
+#define BMSTRINGREF_H
+
+#include <bString.h>
+
+/*
+ * A pointer and a length into text owned by someone else, a C string or a
+ * String. Nothing is copied, so a StringRef must not outlive the text it
+ * looks at. Make a String with toString() to keep the text.
+ *
+ * Views made from a C string or a String know they end in a NULL, and so
+ * does any substring or trim that keeps the same end. Those can be handed
+ * to C code without a copy, see toCString().
+ *
+ * Like String, an empty view gives NULL rather than "" to C code.
+ */
+class StringRef
+{
+public:
+	StringRef();
+	StringRef(const char* value);
+	StringRef(const char* value, int length);
+	StringRef(const String& value);
+
+	// information
+	const char* getBuffer() const;
+	int length() const;
+	bool isEmpty() const;
+	bool isTerminated() const;
+
+	// comparison
+	bool equals(const char* other) const;
+	bool equals(const StringRef& other) const;
+	bool startsWith(const char* prefix) const;
+	unsigned int hash() const;
+
+	// lookup
+	char charAt(int index) const;
+	int indexOf(char ch, int fromIndex = 0) const;
+	char operator[](int index) const;
+
+	// views
+	StringRef substring(int beginning, int end = -1) const;
+	StringRef trimmed() const;
+
+	// copies
+	String toString() const;
+	const char* toCString(String& storage) const;
+
+private:
+	const char* _data;
+	int _length;
+	bool _terminated;
+};
+
+// needed for HashMap keys, hashes the same as String
+struct hashref
+{
+	unsigned int operator()(const StringRef& s) const { return s.hash(); }
+};
+
+struct eqref
+{
+	bool operator()(const StringRef& s1, const StringRef& s2) const
+	{
+		return s1.equals(s2);
+	}
+};
+
+#endif
+
@@ -0,0 +1,207 @@
+#include <Symbol.h>
+#include <HashMap.h>
+#include <Thread.h>
+#include <stddef.h>
+
+/*
+ * the symbol table. it is created on first use and never destroyed, so
+ * Symbols in static objects can safely outlive everything else.
+ */
+struct SymbolTable
+{
+	HashMap< const char*, void*, hashstr, eqstr > entries;
+	Mutex mutex;
+};
+
+static SymbolTable& symbolTable()
+{
+	static SymbolTable* table = new SymbolTable;
+	return *table;
+}
+
+/*
+ * Default constructor. The empty symbol.
+ */
+Symbol::Symbol()
+: _entry(NULL)
+{
+
+}
+
+/*
+ * Constructor. Finds the name in the table, adding it if it isn't there.
+ * @param name the name
+ */
+Symbol::Symbol(const char* name)
+: _entry(NULL)
+{
+	if (!name || !*name)
+		return;
+	SymbolTable& table = symbolTable();
+	table.mutex.lock();
+	void** found = table.entries.find(name);
+	if (found)
+		_entry = (Entry*)*found;
+	else
+	{
+		_entry = new Entry;
+		_entry->name = name;
+		_entry->refs = 0;
+		table.entries.insert(_entry->name, _entry);
+	}
+	_entry->refs++;
+	table.mutex.unlock();
+}
+
+/*
+ * Copy constructor
+ * @param other the symbol to copy
+ */
+Symbol::Symbol(const Symbol& other)
+: _entry(other._entry)
+{
+	acquire();
+}
+
+/*
+ * Destructor
+ */
+Symbol::~Symbol()
+{
+	release();
+}
+
+/*
+ * find the symbol for a name without adding the name to the table
+ * @param name the name
+ * @return the symbol, or the empty symbol if the name isn't in the table
+ */
+Symbol Symbol::find(const char* name)
+{
+	Symbol symbol;
+	if (!name || !*name)
+		return symbol;
+	SymbolTable& table = symbolTable();
+	table.mutex.lock();
+	void** found = table.entries.find(name);
+	if (found)
+	{
+		symbol._entry = (Entry*)*found;
+		symbol._entry->refs++;
+	}
+	table.mutex.unlock();
+	return symbol;
+}
+
+/*
+ * get the number of names in the table
+ * @return name count
+ */
+int Symbol::count()
+{
+	SymbolTable& table = symbolTable();
+	table.mutex.lock();
+	int count = table.entries.size();
+	table.mutex.unlock();
+	return count;
+}
+
+/*
+ * get the name
+ * @return the name, empty for the empty symbol
+ */
+const String& Symbol::getName() const
+{
+	static const String empty;
+	return _entry ? _entry->name : empty;
+}
+
+/*
+ * get the length of the name
+ * @return length
+ */
+int Symbol::length() const
+{
+	return _entry ? _entry->name.length() : 0;
+}
+
+/*
+ * check for the empty symbol
+ * @return true or false
+ */
+bool Symbol::isEmpty() const
+{
+	return _entry == NULL;
+}
+
+/*
+ * get the name as a C string
+ * @return the name, NULL for the empty symbol (like an empty String)
+ */
+Symbol::operator const char*() const
+{
+	return _entry ? (const char*)_entry->name : NULL;
+}
+
+/*
+ * hash of the symbol for hash tables. based on the entry, not the name.
+ * @return hash value
+ */
+unsigned int Symbol::hash() const
+{
+	// entries are heap allocated so the low bits carry nothing
+	unsigned int value = (unsigned int)((size_t)_entry >> 4);
+	value ^= value >> 15;
+	value *= 0x2c1b3c6dU;
+	value ^= value >> 12;
+	return value;
+}
+
+/*
+ * assignment
+ * @param other the symbol to copy
+ * @return this
+ */
+Symbol& Symbol::operator=(const Symbol& other)
+{
+	if (other._entry != _entry)
+	{
+		release();
+		_entry = other._entry;
+		acquire();
+	}
+	return *this;
+}
+
+/*
+ * add a reference to the entry
+ */
+void Symbol::acquire()
+{
+	if (!_entry)
+		return;
+	SymbolTable& table = symbolTable();
+	table.mutex.lock();
+	_entry->refs++;
+	table.mutex.unlock();
+}
+
+/*
+ * drop a reference to the entry, removing it from the table if it was the
+ * last one
+ */
+void Symbol::release()
+{
+	if (!_entry)
+		return;
+	SymbolTable& table = symbolTable();
+	table.mutex.lock();
+	if (--_entry->refs == 0)
+	{
+		table.entries.erase(_entry->name);
+		delete _entry;
+	}
+	table.mutex.unlock();
+	_entry = NULL;
+}
+
@@ -0,0 +1,85 @@
+/*
+ * Symbol.h : interned, reference counted names
+ */
+
+#ifndef BMSYMBOL_H
+#define BMSYMBOL_H
+
+#include <bString.h>
+
+/*
+ * A handle to a name kept in a process wide table. Each distinct name is
+ * stored once, so two Symbols are equal exactly when they point at the same
+ * entry and comparing them is a pointer comparison. Entries are reference
+ * counted and leave the table when the last Symbol for them goes. The empty
+ * name is the NULL entry.
+ *
+ * Creating, copying and destroying Symbols locks the table, comparing them
+ * doesn't.
+ */
+class Symbol
+{
+public:
+	Symbol();
+	explicit Symbol(const char* name);
+	Symbol(const Symbol& other);
+	virtual ~Symbol();
+
+	// lookup without adding to the table
+	static Symbol find(const char* name);
+	static int count();
+
+	// information
+	const String& getName() const;
+	int length() const;
+	bool isEmpty() const;
+	operator const char*() const;
+
+	// comparison
+	bool operator==(const Symbol& other) const { return _entry == other._entry; }
+	bool operator!=(const Symbol& other) const { return _entry != other._entry; }
+	bool operator<(const Symbol& other) const { return _entry < other._entry; }
+	unsigned int hash() const;
+
+	// operators
+	Symbol& operator=(const Symbol& other);
+
+private:
+	struct Entry
+	{
+		String name;
+		int refs;
+	};
+
+	void acquire();
+	void release();
+
+	Entry* _entry;
+};
+
+// needed for HashMap keys
+struct hashsym
+{
+	unsigned int operator()(const Symbol& s) const { return s.hash(); }
+};
+
+struct eqsym
+{
+	bool operator()(const Symbol& s1, const Symbol& s2) const
+	{
+		return s1 == s2;
+	}
+};
+
+#ifdef STRING_STD_HASH
+namespace std
+{
+	template<> struct hash< Symbol >
+	{
+		size_t operator()(const Symbol& s) const { return s.hash(); }
+	};
+}
+#endif
+
+#endif
+
@@ -1,4 +1,8 @@
 #include <Thread.h>
+#ifdef THREAD_PTHREADS
+#include <time.h>
+#include <errno.h>
+#endif
 
 Thread::Thread()
 : _thread(NULL)
@@ -82,3 +86,227 @@ void Thread::unlock()
 #endif
 }
 
+Mutex::Mutex()
+#ifndef WIN32
+: _mutex(NULL)
+#endif
+{
+#ifdef THREAD_PTHREADS
+	_mutex = new pthread_mutex_t;
+	pthread_mutex_init(_mutex, NULL);
+#elif !defined(WIN32)
+	if (!g_thread_supported())
+		g_thread_init(NULL);
+	_mutex = g_mutex_new();
+#else
+	InitializeCriticalSection(&_section);
+#endif
+}
+
+Mutex::~Mutex()
+{
+#ifdef THREAD_PTHREADS
+	pthread_mutex_destroy(_mutex);
+	delete _mutex;
+	_mutex = NULL;
+#elif !defined(WIN32)
+	if (_mutex)
+		g_mutex_free(_mutex);
+	_mutex = NULL;
+#else
+	DeleteCriticalSection(&_section);
+#endif
+}
+
+void Mutex::lock()
+{
+#ifdef THREAD_PTHREADS
+	pthread_mutex_lock(_mutex);
+#elif !defined(WIN32)
+	if (_mutex)
+		g_mutex_lock(_mutex);
+#else
+	EnterCriticalSection(&_section);
+#endif
+}
+
+void Mutex::unlock()
+{
+#ifdef THREAD_PTHREADS
+	pthread_mutex_unlock(_mutex);
+#elif !defined(WIN32)
+	if (_mutex)
+		g_mutex_unlock(_mutex);
+#else
+	LeaveCriticalSection(&_section);
+#endif
+}
+
+
+Condition::Condition()
+#ifndef WIN32
+: _cond(NULL)
+#else
+: _semaphore(NULL)
+, _waiters(0)
+#endif
+{
+#ifdef THREAD_PTHREADS
+	pthread_condattr_t attributes;
+	pthread_condattr_init(&attributes);
+	pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+	_cond = new pthread_cond_t;
+	pthread_cond_init(_cond, &attributes);
+	pthread_condattr_destroy(&attributes);
+#elif !defined(WIN32)
+	if (!g_thread_supported())
+		g_thread_init(NULL);
+	_cond = g_cond_new();
+#else
+	_semaphore = CreateSemaphore(NULL, 0, 0x7fffffff, NULL);
+#endif
+}
+
+Condition::~Condition()
+{
+#ifdef THREAD_PTHREADS
+	pthread_cond_destroy(_cond);
+	delete _cond;
+	_cond = NULL;
+#elif !defined(WIN32)
+	if (_cond)
+		g_cond_free(_cond);
+	_cond = NULL;
+#else
+	if (_semaphore)
+		CloseHandle(_semaphore);
+	_semaphore = NULL;
+#endif
+}
+
+void Condition::wait(Mutex& mutex)
+{
+#ifdef THREAD_PTHREADS
+	pthread_cond_wait(_cond, mutex._mutex);
+#elif !defined(WIN32)
+	if (_cond && mutex._mutex)
+		g_cond_wait(_cond, mutex._mutex);
+#else
+	wait(mutex, INFINITE);
+#endif
+}
+
+bool Condition::wait(Mutex& mutex, unsigned long milli)
+{
+#ifdef THREAD_PTHREADS
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	end.tv_sec += milli / 1000;
+	end.tv_nsec += (milli % 1000) * 1000000;
+	if (end.tv_nsec >= 1000000000)
+	{
+		end.tv_sec++;
+		end.tv_nsec -= 1000000000;
+	}
+	return pthread_cond_timedwait(_cond, mutex._mutex, &end) != ETIMEDOUT;
+#elif !defined(WIN32)
+	if (!_cond || !mutex._mutex)
+		return false;
+	gint64 end = g_get_monotonic_time() + (gint64)milli * 1000;
+	return g_cond_wait_until(_cond, mutex._mutex, end);
+#else
+	_waiters++;
+	mutex.unlock();
+	DWORD result = WaitForSingleObject(_semaphore, milli);
+	mutex.lock();
+	if (result == WAIT_OBJECT_0)
+		return true;
+	// a signal meant for this thread may have come in between the time
+	// running out and getting the Mutex back
+	if (WaitForSingleObject(_semaphore, 0) == WAIT_OBJECT_0)
+		return true;
+	_waiters--;
+	return false;
+#endif
+}
+
+void Condition::signal()
+{
+#ifdef THREAD_PTHREADS
+	pthread_cond_signal(_cond);
+#elif !defined(WIN32)
+	if (_cond)
+		g_cond_signal(_cond);
+#else
+	if (_waiters > 0)
+	{
+		_waiters--;
+		ReleaseSemaphore(_semaphore, 1, NULL);
+	}
+#endif
+}
+
+void Condition::broadcast()
+{
+#ifdef THREAD_PTHREADS
+	pthread_cond_broadcast(_cond);
+#elif !defined(WIN32)
+	if (_cond)
+		g_cond_broadcast(_cond);
+#else
+	if (_waiters > 0)
+	{
+		ReleaseSemaphore(_semaphore, _waiters, NULL);
+		_waiters = 0;
+	}
+#endif
+}
+
+ThreadLocal::ThreadLocal()
+#ifndef WIN32
+: _private(NULL)
+#else
+: _index(TLS_OUT_OF_INDEXES)
+#endif
+{
+#ifndef WIN32
+	if (!g_thread_supported())
+		g_thread_init(NULL);
+	_private = g_private_new(NULL);
+#else
+	_index = TlsAlloc();
+#endif
+}
+
+ThreadLocal::~ThreadLocal()
+{
+#ifdef WIN32
+	if (_index != TLS_OUT_OF_INDEXES)
+		TlsFree(_index);
+	_index = TLS_OUT_OF_INDEXES;
+#endif
+}
+
+void* ThreadLocal::get() const
+{
+#ifndef WIN32
+	if (_private)
+		return g_private_get(_private);
+	return NULL;
+#else
+	if (_index != TLS_OUT_OF_INDEXES)
+		return TlsGetValue(_index);
+	return NULL;
+#endif
+}
+
+void ThreadLocal::set(void* value)
+{
+#ifndef WIN32
+	if (_private)
+		g_private_set(_private, value);
+#else
+	if (_index != TLS_OUT_OF_INDEXES)
+		TlsSetValue(_index, value);
+#endif
+}
@@ -3,6 +3,13 @@
 
 #ifndef WIN32
 #include <glib.h>
+#if !GLIB_CHECK_VERSION(2, 32, 0)
+// older glib can only time a wait against the wall clock, which jumps when
+// the clock is set. Mutex and Condition are made with pthreads instead so
+// that timed waits go by the monotonic clock
+#define THREAD_PTHREADS
+#include <pthread.h>
+#endif
 #else
 #include <windows.h>
 #endif
@@ -32,5 +39,93 @@ private:
 	
 };
 
+/*
+ * plain mutual exclusion lock for data shared between threads.
+ */
+class Mutex
+{
+public:
+	Mutex();
+	virtual ~Mutex();
+
+	void lock();
+	void unlock();
+
+private:
+	// not copyable
+	Mutex(const Mutex& other);
+	Mutex& operator=(const Mutex& other);
+
+#ifdef THREAD_PTHREADS
+	pthread_mutex_t* _mutex;
+#elif !defined(WIN32)
+	GMutex* _mutex;
+#else
+	CRITICAL_SECTION _section;
+#endif
+	friend class Condition;
+};
+
+/*
+ * lets a thread sleep until another one tells it something has changed.
+ * the waiting thread holds a Mutex, which is let go while it sleeps and
+ * taken back before wait() returns, and the thread calling signal() or
+ * broadcast() must hold the same Mutex. a wait can end without a signal,
+ * so the thing being waited for has to be checked again in a loop. timed
+ * waits aren't thrown out by the system clock being set.
+ */
+class Condition
+{
+public:
+	Condition();
+	virtual ~Condition();
+
+	void wait(Mutex& mutex);
+	bool wait(Mutex& mutex, unsigned long milli);
+	void signal();
+	void broadcast();
+
+private:
+	// not copyable
+	Condition(const Condition& other);
+	Condition& operator=(const Condition& other);
+
+#ifdef THREAD_PTHREADS
+	pthread_cond_t* _cond;
+#elif !defined(WIN32)
+	GCond* _cond;
+#else
+	HANDLE _semaphore;
+	// threads waiting that haven't been signalled yet
+	int _waiters;
+#endif
+};
+
+/*
+ * a pointer that each thread has a copy of its own, NULL until the thread
+ * sets it. whatever it points to is up to the owner to free. glib can't
+ * give the slot back, so there should only be a few of these, made once.
+ */
+class ThreadLocal
+{
+public:
+	ThreadLocal();
+	virtual ~ThreadLocal();
+
+	void* get() const;
+	void set(void* value);
+
+private:
+	// not copyable
+	ThreadLocal(const ThreadLocal& other);
+	ThreadLocal& operator=(const ThreadLocal& other);
+
+#ifndef WIN32
+	GPrivate* _private;
+#else
+	DWORD _index;
+#endif
+};
+
 #endif
 
@@ -9,9 +9,33 @@
 #include <string.h>
 #include <ctype.h>
 #include <regex.h>
+#include "RegexCache.h"
+#include "StringBuilder.h"
+#include <vector>
 
 #define ADJUST_SIZE(size, len) for(size = 1; size <= len; size = size << 1);
 
+/*
+ * find the last occurrence of a character in a block of memory
+ * @param s the memory
+ * @param c the character
+ * @param n the number of bytes to search
+ * @return pointer to the character or NULL if it isn't there
+ */
+static inline const char* findLast(const char* s, char c, int n)
+{
+#if defined(__GLIBC__) && defined(_GNU_SOURCE)
+	return (const char*)memrchr(s, c, n);
+#else
+	while (n-- > 0)
+	{
+		if (s[n] == c)
+			return s + n;
+	}
+	return NULL;
+#endif
+}
+
 /*
  * comparison routine for std::maps involving string keys*
  */
@@ -20,6 +44,32 @@ bool ltstr::operator()(const char* s1, const char* s2) const
 	return strcmp(s1, s2) < 0;
 }
 
+/*
+ * hash routine for HashMaps with string keys. NULL hashes the same as an
+ * empty string.
+ */
+unsigned int hashstr::operator()(const char* s) const
+{
+	return String::hash(s, s ? strlen(s) : 0);
+}
+
+/*
+ * hash routine for HashMaps with String keys, using the cached hash
+ */
+unsigned int hashstr::operator()(const String& s) const
+{
+	return s.hash();
+}
+
+/*
+ * equality routine for HashMaps with string keys. NULL is equal to an empty
+ * string.
+ */
+bool eqstr::operator()(const char* s1, const char* s2) const
+{
+	return strcmp(s1 ? s1 : "", s2 ? s2 : "") == 0;
+}
+
 /*
  * Default constructor.
  * creates an empty string that can be modified.
@@ -28,6 +78,7 @@ String::String()
 : _string(NULL)
 , _alloc(0)
 , _length(0)
+, _hash(0)
 {
 	
 }
@@ -45,6 +96,7 @@ String::String(const char* value, int offset, int count)
 : _string(NULL)
 , _alloc(0)
 , _length(0)
+, _hash(0)
 {
 	if (!value || !strlen(value))
 		return;
@@ -57,7 +109,7 @@ String::String(const char* value, int offset, int count)
 	if (count <= 0) count = len;
 	int size = 0;
 	ADJUST_SIZE(size, len);
-	_string = new char[size];
+	_string = allocate(size);
 	_string[0] = '\0';
 	_alloc = size;
 	_length = len;
@@ -76,6 +128,7 @@ String::String(const String& original, int count, int offset)
 : _string(NULL)
 , _alloc(0)
 , _length(0)
+, _hash(0)
 {
 	if (!original.length())
 		return;
@@ -88,23 +141,86 @@ String::String(const String& original, int count, int offset)
 	if (count <= 0) count = len;
 	int size = 0;
 	ADJUST_SIZE(size, len);
-	_string = new char[size];
+	_string = allocate(size);
 	_string[0] = '\0';
 	_alloc = size;
 	_length = len;
 	strncat(_string, (char*)(original._string + offset), count);
 }
 
+#ifdef STRING_MOVE
+/*
+ * Move constructor.
+ * Takes over the contents of a String, which is left empty.
+ * @param original the string to take from.
+ */
+String::String(String&& original) STRING_NOEXCEPT
+: _string(NULL)
+, _alloc(0)
+, _length(0)
+, _hash(0)
+{
+	take(original);
+}
+#endif
+
 /*!
  * Destructor
  */
 String::~String()
 {
-	if (_string)
+	release();
+}
+
+/*
+ * get a buffer for the contents of the string. short strings go in the
+ * built in buffer unless that is already in use.
+ * @param size the number of bytes needed
+ * @return the buffer
+ */
+char* String::allocate(int size)
+{
+	if (size <= STRING_SMALL_SIZE && _string != _small)
+		return _small;
+	return new char[size];
+}
+
+/*
+ * free the buffer holding the contents of the string. this does not reset
+ * the members.
+ */
+void String::release()
+{
+	if (_string && _string != _small)
 		delete [] _string;
 	_string = NULL;
 }
 
+#ifdef STRING_MOVE
+/*
+ * take over the contents of another string, leaving it empty. the current
+ * contents must already have been released.
+ * @param other the string to take from
+ */
+void String::take(String& other)
+{
+	if (other._string == other._small)
+	{
+		memcpy(_small, other._small, other._length + 1);
+		_string = _small;
+	}
+	else
+		_string = other._string;
+	_alloc = other._alloc;
+	_length = other._length;
+	_hash = other._hash;
+	other._string = NULL;
+	other._alloc = 0;
+	other._length = 0;
+	other._hash = 0;
+}
+#endif
+
 /*
  * Compares this string to the specified object.
  * @param other the character string to compare this String against.
@@ -232,29 +348,39 @@ bool String::equalsIgnoreCase(const String& other) const
  */
 String& String::concat(const char* other)
 {
-	if (!other || !strlen(other))
+	if (!other)
+		return *this;
+	return concat(other, strlen(other));
+}
+
+/*
+ * add a string of known length to this string, so it isn't measured again
+ * @param other the string to add
+ * @param otherLen its length
+ * @return this string with the other string added.
+ */
+String& String::concat(const char* other, int otherLen)
+{
+	if (!other || otherLen <= 0)
 		return *this;
 	int thisLen = length();
-	int otherLen = strlen(other);
 	if (_alloc <= thisLen + otherLen)
 	{
 		int size = 0;
 		ADJUST_SIZE(size, thisLen + otherLen)
-		char* temp = new char[size];
-		temp[0] = '\0';
-		if (_string)
-			strcat(temp, _string);
-		strcat(temp, other);
-		delete [] _string;
+		char* temp = allocate(size);
+		if (thisLen > 0)
+			memcpy(temp, _string, thisLen);
+		memcpy(temp + thisLen, other, otherLen);
+		release();
 		_string = temp;
 		_alloc = size;
-		_length = thisLen + otherLen;
 	}
 	else
-	{
-		strcat(_string, other);
-		_length = thisLen + otherLen;
-	}
+		memmove(_string + thisLen, other, otherLen);
+	_length = thisLen + otherLen;
+	_string[_length] = '\0';
+	_hash = 0;
 	return *this;
 }
 
@@ -265,7 +391,7 @@ String& String::concat(const char* other)
  */
 String& String::concat(const String& other)
 {
-	return concat(other._string);
+	return concat(other._string, other._length);
 }
 
 /*
@@ -278,6 +404,7 @@ String& String::replace(char oldChar, char newChar)
 {
 	if (oldChar == '\0' || newChar == '\0')
 		return *this; // exemptions
+	_hash = 0;
 	for (int i = 0; i < _length; i++)
 	{
 		if (_string[i] == oldChar)
@@ -296,47 +423,7 @@ String& String::replace(char oldChar, char newChar)
 String& String::replaceAll(const char* regex, const char* replacement,
 		bool ignoreCase)
 {
-	if (!regex || !strlen(regex) || !replacement)
-		return *this;
-
-	regex_t re;
-	regmatch_t pm;
-	int flags = REG_EXTENDED;
-	if (ignoreCase)
-		flags &= REG_ICASE;
-	if (regcomp(&re, regex, flags) != 0)
-		return *this;
-	int error = regexec(&re, _string, 1, &pm, 0);
-	while (error == 0)
-	{
-		int start = pm.rm_so;
-		int end = pm.rm_eo;
-		int newlen = _length - (end - start) + strlen(replacement);
-		int size = 1;
-		ADJUST_SIZE(size, newlen)
-		char* temp = NULL;
-		bool alloced = true;
-		if (size <= _alloc)
-		{
-			size = _alloc;
-			alloced = false;
-		}
-		temp = new char[size];
-		temp[0] = '\0';
-		if (start > 0)
-			strncat(temp, _string, start);
-		strcat(temp, replacement);
-		if (end < _length)
-			strcat(temp, _string + end);
-		_length = newlen;
-		if (alloced)
-			_alloc = size;
-		delete [] _string;
-		_string = temp;
-		error = regexec(&re, _string + pm.rm_eo, 1, &pm, REG_NOTBOL);
-	}
-	regfree(&re);
-	return *this;
+	return replaceMatches(regex, replacement, ignoreCase, true);
 }
 
 /*
@@ -361,45 +448,98 @@ String& String::replaceAll(const String& regex, const String& replacement,
  */
 String& String::replaceFirst(const char* regex, const char* replacement,
 		bool ignoreCase)
+{
+	return replaceMatches(regex, replacement, ignoreCase, false);
+}
+
+/*
+ * find the next match for a regular expression. where regexec() can be told
+ * where the text ends it isn't measured again for every match, which would
+ * make replacing all the matches in a long line quadratic.
+ * @param re the compiled expression
+ * @param text the text
+ * @param from where to start looking
+ * @param length the length of the text
+ * @param match set to the match, from the start of the text
+ * @return true if there was a match
+ */
+static bool search(const regex_t* re, const char* text, int from, int length,
+		regmatch_t& match)
+{
+	int flags = from > 0 ? REG_NOTBOL : 0;
+#ifdef REG_STARTEND
+	match.rm_so = from;
+	match.rm_eo = length;
+	return regexec(re, text, 1, &match, flags | REG_STARTEND) == 0;
+#else
+	if (from > length || regexec(re, text + from, 1, &match, flags) != 0)
+		return false;
+	match.rm_so += from;
+	match.rm_eo += from;
+	return true;
+#endif
+}
+
+/*
+ * replace matches for a regular expression with the replacement string. the
+ * matches are found in one pass over the string and the result is put
+ * together in a single buffer of the right size.
+ * @param regex the regular expression to match for
+ * @param replacement the replacement string
+ * @param ignoreCase true for a case insensitive match
+ * @param all true to replace every match, false for just the first
+ * @return this.
+ */
+String& String::replaceMatches(const char* regex, const char* replacement,
+		bool ignoreCase, bool all)
 {
 	if (!regex || !strlen(regex) || !replacement)
 		return *this;
-	regex_t re;
-	regmatch_t pm;
 	int flags = REG_EXTENDED;
 	if (ignoreCase)
-		flags &= REG_ICASE;
-	if (regcomp(&re, regex, flags) != 0)
+		flags |= REG_ICASE;
+	CachedRegex re(regex, flags);
+	if (!re.isValid())
 		return *this;
-	int error = regexec(&re, _string, 1, &pm, 0);
-	if (error == 0)
+
+	const char* text = _string ? _string : "";
+	std::vector< regmatch_t > spans;
+	regmatch_t pm;
+	int pos = 0;
+	int removed = 0;
+	while (pos <= _length && search(re.get(), text, pos, _length, pm))
 	{
-		int start = pm.rm_so;
-		int end = pm.rm_eo;
-		int newlen = _length - (end - start) + strlen(replacement);
-		int size = 1;
-		ADJUST_SIZE(size, newlen)
-		char* temp = NULL;
-		bool alloced = true;
-		if (size <= _alloc)
+		// like sed, an empty match straight after a match doesn't count
+		if (pm.rm_so == pm.rm_eo && !spans.empty() &&
+				spans.back().rm_eo == pm.rm_so)
 		{
-			size = _alloc;
-			alloced = false;
+			pos = pm.rm_eo + 1;
+			continue;
 		}
-		temp = new char[size];
-		temp[0] = '\0';
-		if (start > 0)
-			strncat(temp, _string, start);
-		strcat(temp, replacement);
-		if (end < _length)
-			strcat(temp, _string + end);
-		_length = newlen;
-		if (alloced)
-			_alloc = size;
-		delete [] _string;
-		_string = temp;	
+		spans.push_back(pm);
+		removed += pm.rm_eo - pm.rm_so;
+		if (!all)
+			break;
+		// step over an empty match so it isn't found again
+		pos = pm.rm_eo;
+		if (pm.rm_eo == pm.rm_so)
+			pos++;
+	}
+	if (spans.empty())
+		return *this;
+
+	int replen = strlen(replacement);
+	int count = spans.size();
+	StringBuilder result(_length - removed + replen * count);
+	int last = 0;
+	for (int i = 0; i < count; i++)
+	{
+		result.append(text + last, spans[i].rm_so - last);
+		result.append(replacement, replen);
+		last = spans[i].rm_eo;
 	}
-	regfree(&re);
+	result.append(text + last, _length - last);
+	result.moveTo(*this);
 	return *this;
 }
 
@@ -431,11 +571,14 @@ String String::substring(int beginning, int end) const
 	int sublen = end - beginning;
 	if (sublen <= 0)
 		return String();
-	char* temp = new char[sublen + 1];
-	temp[0] = '\0';
-	strncat(temp, _string + beginning, sublen);
-	String out(temp);
-	delete [] temp;
+	String out;
+	int size = 0;
+	ADJUST_SIZE(size, sublen)
+	out._string = out.allocate(size);
+	out._alloc = size;
+	out._length = sublen;
+	memcpy(out._string, _string + beginning, sublen);
+	out._string[sublen] = '\0';
 	return out;
 }
 
@@ -445,6 +588,7 @@ String String::substring(int beginning, int end) const
  */
 String& String::toLowerCase()
 {
+	_hash = 0;
 	for (int i = 0; i < _length; i++)
 		_string[i] = tolower(_string[i]);
 	return *this;
@@ -456,6 +600,7 @@ String& String::toLowerCase()
  */
 String& String::toUpperCase()
 {
+	_hash = 0;
 	for (int i = 0; i < _length; i++)
 		_string[i] = toupper(_string[i]);
 	return *this;
@@ -467,6 +612,7 @@ String& String::toUpperCase()
  */
 String& String::trim()
 {
+	_hash = 0;
 	// first look for the beginning white space
 	int i;
 	for (i = 0; i < _length; i++)
@@ -474,12 +620,8 @@ String& String::trim()
 			break;
 	if (i > 0 && i < _length)
 	{
-		char* temp = new char[_alloc];
-		memset(temp, '\0', sizeof(char) * _alloc);
-		strcpy(temp, _string + i);
 		_length -= i;
-		delete [] _string;
-		_string = temp;
+		memmove(_string, _string + i, _length + 1);
 	}
 
 	// now the tail bit
@@ -522,8 +664,10 @@ bool String::startsWith(const char* prefix, int offset) const
 		return false;
 	if (offset < 0)
 		return false;
-	int index = indexOf(prefix, offset);
-	return index == offset;
+	int len = strlen(prefix);
+	if (len > _length - offset)
+		return false;
+	return memcmp(_string + offset, prefix, len) == 0;
 }
 
 /*
@@ -547,8 +691,9 @@ bool String::endsWith(const char* suffix) const
 	if (!_length || !suffix || !strlen(suffix))
 		return false;
 	int len = strlen(suffix);
-	int index = lastIndexOf(suffix);
-	return index == _length - len;
+	if (len > _length)
+		return false;
+	return memcmp(_string + _length - len, suffix, len) == 0;
 }
 
 /*
@@ -571,10 +716,13 @@ int String::indexOf(char ch, int fromIndex) const
 {
 	if (!_length || _length - fromIndex <= 0 || ch == '\0')
 		return -1;
-	char* result = strchr(_string + fromIndex, ch);
+	if (fromIndex < 0)
+		fromIndex = 0;
+	const char* result = (const char*)memchr(_string + fromIndex, ch,
+			_length - fromIndex);
 	if (!result)
 		return -1;
-	return _length - strlen(result);
+	return result - _string;
 }
 
 /*
@@ -589,11 +737,10 @@ int String::indexOf(const char* str, int fromIndex) const
 		return -1;
 	if (fromIndex < 0)
 		return false;
-	//int len = strlen(_string + fromIndex);
-	char* result = strstr(_string + fromIndex, str);
+	const char* result = strstr(_string + fromIndex, str);
 	if (!result)
 		return -1;
-	return _length - strlen(result);
+	return result - _string;
 }
 
 /*
@@ -620,17 +767,12 @@ int String::lastIndexOf(char ch, int fromIndex) const
 		fromIndex = _length;
 	if (!_length || _length - fromIndex < 0)
 		return -1;
-	char* cpy = new char[fromIndex + 1];
-	cpy[0] = '\0';
-	strncpy(cpy, _string, fromIndex);
-	char* result = strrchr(cpy, ch);
-	int index = -1;
+	if (ch == '\0')
+		return fromIndex;
+	const char* result = findLast(_string, ch, fromIndex);
 	if (!result)
-		index = -1;
-	else
-		index = fromIndex - strlen(result);
-	delete [] cpy;
-	return index;
+		return -1;
+	return result - _string;
 }
 
 /*
@@ -646,21 +788,20 @@ int String::lastIndexOf(const char* str, int fromIndex) const
 		fromIndex = _length;
 	if (!_length || _length - fromIndex < 0 || !str || !strlen(str))
 		return -1;
-	char* cpy = new char[fromIndex + 1];
-	cpy[0] = '\0';
-	strncpy(cpy, _string, fromIndex);
 
+	// jump between occurrences of the first character of str
 	int len = strlen(str);
-	int pos = fromIndex - len;
-	while (pos >= 0)
+	int last = fromIndex - len;
+	while (last >= 0)
 	{
-		if (strncmp(cpy + pos, str, len) == 0)
+		const char* result = findLast(_string, str[0], last + 1);
+		if (!result)
 			break;
-		pos--;
+		if (memcmp(result, str, len) == 0)
+			return result - _string;
+		last = result - _string - 1;
 	}
-
-	delete [] cpy;
-	return pos;
+	return -1;
 }
 
 /*
@@ -694,15 +835,14 @@ bool String::matches(const char* regex, bool ignoreCase) const
 {
 	if (!regex || !strlen(regex))
 		return false;
-	regex_t re;
 	regmatch_t pm;
 	int flags = REG_EXTENDED;
 	if (ignoreCase)
-		flags &= REG_ICASE;
-	if (regcomp(&re, regex, flags) != 0)
+		flags |= REG_ICASE;
+	CachedRegex re(regex, flags);
+	if (!re.isValid())
 		return false;
-	int error = regexec(&re, _string, 1, &pm, 0);
-	regfree(&re);
+	int error = regexec(re.get(), _string, 1, &pm, 0);
 	if (error == 0)
 		return true;
 	return false;
@@ -721,19 +861,99 @@ bool String::matches(const String& regex, bool ignoreCase) const
 /*
  * generate a hash code for the string. This is no longer valid when the string
  * is modified.
- * @return the hash code based on the contents of the string.
+ * @return the hash code based on the contents of the string, never negative.
  */
 int String::hashCode() const
 {
-	int hash = 0;
-	for (int i = 0; i < _length; i++)
+	return hash() & 0x7fffffff;
+}
+
+/*
+ * get the hash of the contents. it is worked out the first time it is asked
+ * for and kept until the string changes.
+ * @return the hash, the same as hash(*this, length())
+ */
+unsigned int String::hash() const
+{
+	if (_hash == 0)
+		_hash = hash(_string, _length);
+	return _hash;
+}
+
+// xxHash32 constants
+#define HASH_PRIME1 (2654435761U)
+#define HASH_PRIME2 (2246822519U)
+#define HASH_PRIME3 (3266489917U)
+#define HASH_PRIME4 (668265263U)
+#define HASH_PRIME5 (374761393U)
+
+#define HASH_ROTATE(x, r) (((x) << (r)) | ((x) >> (32 - (r))))
+
+/*
+ * read four bytes as a little endian number, whatever the machine and the
+ * alignment
+ */
+static inline unsigned int hashRead(const unsigned char* p)
+{
+	return (unsigned int)p[0] | ((unsigned int)p[1] << 8) |
+		((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+/*
+ * hash a block of bytes (xxHash32, seed 0). it works four bytes at a time
+ * in four independent lanes and mixes every bit of the input into every bit
+ * of the result, so the low bits are good enough to pick a hash table slot.
+ * @param data the bytes, may be NULL if length is 0
+ * @param length the number of bytes
+ * @return the hash
+ */
+unsigned int String::hash(const char* data, int length)
+{
+	const unsigned char* p = (const unsigned char*)data;
+	const unsigned char* end = p + (length > 0 ? length : 0);
+	unsigned int h;
+	if (length >= 16)
 	{
-		char c = _string[i];
-		if (c >= 0140)
-			c -= 40;
-		hash = ((hash << 3) + (hash >> 28) + c);
+		unsigned int v1 = HASH_PRIME1 + HASH_PRIME2;
+		unsigned int v2 = HASH_PRIME2;
+		unsigned int v3 = 0;
+		unsigned int v4 = 0 - HASH_PRIME1;
+		const unsigned char* limit = end - 16;
+		do
+		{
+			v1 += hashRead(p) * HASH_PRIME2;
+			v1 = HASH_ROTATE(v1, 13) * HASH_PRIME1;
+			v2 += hashRead(p + 4) * HASH_PRIME2;
+			v2 = HASH_ROTATE(v2, 13) * HASH_PRIME1;
+			v3 += hashRead(p + 8) * HASH_PRIME2;
+			v3 = HASH_ROTATE(v3, 13) * HASH_PRIME1;
+			v4 += hashRead(p + 12) * HASH_PRIME2;
+			v4 = HASH_ROTATE(v4, 13) * HASH_PRIME1;
+			p += 16;
+		} while (p <= limit);
+		h = HASH_ROTATE(v1, 1) + HASH_ROTATE(v2, 7) +
+			HASH_ROTATE(v3, 12) + HASH_ROTATE(v4, 18);
 	}
-	return hash & 07777777777;
+	else
+		h = HASH_PRIME5;
+	h += (unsigned int)(length > 0 ? length : 0);
+	while (p + 4 <= end)
+	{
+		h += hashRead(p) * HASH_PRIME3;
+		h = HASH_ROTATE(h, 17) * HASH_PRIME4;
+		p += 4;
+	}
+	while (p < end)
+	{
+		h += (*p++) * HASH_PRIME5;
+		h = HASH_ROTATE(h, 11) * HASH_PRIME1;
+	}
+	h ^= h >> 15;
+	h *= HASH_PRIME2;
+	h ^= h >> 13;
+	h *= HASH_PRIME3;
+	h ^= h >> 16;
+	return h;
 }
 
 // operators
@@ -744,8 +964,15 @@ bool String::operator==(const String& other) const
 
 String& String::operator=(const char* other)
 {
-	delete [] _string;
-	_string = NULL;
+	_hash = 0;
+	// assigning part of ourselves
+	if (other && _string && other >= _string && other < _string + _alloc)
+	{
+		_length = strlen(other);
+		memmove(_string, other, _length + 1);
+		return *this;
+	}
+	release();
 	_length = 0;
 	_alloc = 0;
 	if (!other)
@@ -755,9 +982,8 @@ String& String::operator=(const char* other)
 	{
 		int size;
 		ADJUST_SIZE(size, len)
-		_string = new char[size];
-		_string[0] = '\0';
-		strcat(_string, other);
+		_string = allocate(size);
+		memcpy(_string, other, len + 1);
 		_alloc = size;
 		_length = len;
 	}
@@ -769,6 +995,18 @@ String& String::operator=(const String& other)
 	return operator=(other._string);
 }
 
+#ifdef STRING_MOVE
+String& String::operator=(String&& other) STRING_NOEXCEPT
+{
+	if (&other != this)
+	{
+		release();
+		take(other);
+	}
+	return *this;
+}
+#endif
+
 String& String::operator+=(const char* other)
 {
 	return concat(other);
@@ -776,7 +1014,7 @@ String& String::operator+=(const char* other)
 
 String& String::operator+=(const String& other)
 {
-	return concat(other);
+	return concat(other._string, other._length);
 }
 
 /*
@@ -784,9 +1022,11 @@ String& String::operator+=(const String& other)
  */
 char& String::operator[](int index)
 {
+	// the character may be written through the reference
+	_hash = 0;
 	if (!_alloc)
 	{
-		_string = new char[2];
+		_string = allocate(2);
 		_string[0] = '\0';
 		_length = 1;
 		_alloc = 2;
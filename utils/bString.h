@@ -8,18 +8,50 @@
 #ifndef _COMMON_STRING_H
 #define _COMMON_STRING_H
 
+// strings shorter than this are kept inside the String, not on the heap
+#define STRING_SMALL_SIZE (16)
+
+// move construction and assignment need a C++11 compiler (or VC 2010), so
+// does std::hash
+#if __cplusplus >= 201103L
+#define STRING_MOVE
+#define STRING_NOEXCEPT noexcept
+#define STRING_STD_HASH
+#elif defined(_MSC_VER) && _MSC_VER >= 1600
+#define STRING_MOVE
+#define STRING_NOEXCEPT
+#define STRING_STD_HASH
+#endif
+
+class String;
+
 // needed for map comparison
 struct ltstr
 {
 	bool operator()(const char* s1, const char* s2) const;
 };
 
+// needed for HashMap keys
+struct hashstr
+{
+	unsigned int operator()(const char* s) const;
+	unsigned int operator()(const String& s) const;
+};
+
+struct eqstr
+{
+	bool operator()(const char* s1, const char* s2) const;
+};
+
 class String
 {
 public:
 	String();
 	String(const char* value, int offset = 0, int count = -1);
 	String(const String& original, int offset = 0, int count = -1);
+#ifdef STRING_MOVE
+	String(String&& original) STRING_NOEXCEPT;
+#endif
 	virtual ~String();
 	
 	// comparison
@@ -67,21 +99,54 @@ public:
 	
 	// other
 	int hashCode() const;
+	unsigned int hash() const;
+	static unsigned int hash(const char* data, int length);
 	
 	// operators
 	bool operator==(const String& other) const;
 	String& operator=(const char* other);
 	String& operator=(const String& other);
+#ifdef STRING_MOVE
+	String& operator=(String&& other) STRING_NOEXCEPT;
+#endif
 	String& operator+=(const char* other);
 	String& operator+=(const String& other);
 	char& operator[](int index);
 	operator const char*() const;
 	
 private:
+	friend class StringBuilder;
+
+	char* allocate(int size);
+	void release();
+	String& concat(const char* other, int otherLen);
+	String& replaceMatches(const char* regex,
+			const char* replacement, bool ignoreCase, bool all);
+#ifdef STRING_MOVE
+	void take(String& other);
+#endif
+
 	char*	_string;
 	int	_alloc;
 	int	_length;
+	// hash of the contents, 0 until worked out. anything that changes the
+	// contents resets it
+	mutable unsigned int _hash;
+	// storage for short strings, _string points here when it is used
+	char	_small[STRING_SMALL_SIZE];
 };
 
+#ifdef STRING_STD_HASH
+#include <functional>
+
+namespace std
+{
+	template<> struct hash< String >
+	{
+		size_t operator()(const String& s) const { return s.hash(); }
+	};
+}
+#endif
+
 #endif
 
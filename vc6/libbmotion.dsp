@@ -96,6 +96,22 @@ SOURCE=..\system\Abstract.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=..\system\AbstractCache.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=..\system\AbstractJournal.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=..\system\AbstractLoader.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=..\system\AbstractPack.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=..\plugin\AdminPlugin.cpp
 # End Source File
 # Begin Source File
@@ -132,10 +148,22 @@ SOURCE=..\system\Library.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=..\utils\LiteralSet.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=..\utils\MappedFile.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=..\system\Mood.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=..\system\Normaliser.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=..\system\Output.cpp
 # End Source File
 # Begin Source File
@@ -144,10 +172,26 @@ SOURCE=..\plugin\OutputPlugin.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=..\utils\Pattern.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=..\utils\PatternSet.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=..\plugin\Plugin.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=..\system\PluginMatcher.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=..\utils\RegexCache.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=..\plugin\Register.cpp
 # End Source File
 # Begin Source File
@@ -160,6 +204,18 @@ SOURCE=..\plugin\SimplePlugin.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=..\utils\StringBuilder.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=..\utils\StringRef.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=..\utils\Symbol.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=..\system\System.cpp
 # End Source File
 # Begin Source File
@@ -170,6 +226,18 @@ SOURCE=..\utils\Thread.cpp
 
 SOURCE=..\system\Timer.cpp
 # End Source File
+# Begin Source File
+
+SOURCE=..\system\TimerHeap.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=..\system\TimerPool.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=..\system\TimerWheel.cpp
+# End Source File
 # End Group
 # Begin Group "Header Files"
 
@@ -180,6 +248,22 @@ SOURCE=..\system\Abstract.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\system\AbstractCache.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\system\AbstractJournal.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\system\AbstractLoader.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\system\AbstractPack.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\plugin\AdminPlugin.h
 # End Source File
 # Begin Source File
@@ -208,14 +292,30 @@ SOURCE=..\utils\File.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\utils\HashMap.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\system\Library.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\utils\LiteralSet.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\utils\MappedFile.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\system\Mood.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\system\Normaliser.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\system\Output.h
 # End Source File
 # Begin Source File
@@ -224,10 +324,26 @@ SOURCE=..\plugin\OutputPlugin.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\utils\Pattern.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\utils\PatternSet.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\plugin\Plugin.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\system\PluginMatcher.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\utils\RegexCache.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\plugin\Register.h
 # End Source File
 # Begin Source File
@@ -240,6 +356,18 @@ SOURCE=..\plugin\SimplePlugin.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\utils\StringBuilder.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\utils\StringRef.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\utils\Symbol.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\system\System.h
 # End Source File
 # Begin Source File
@@ -250,6 +378,22 @@ SOURCE=..\utils\Thread.h
 
 SOURCE=..\system\Timer.h
 # End Source File
+# Begin Source File
+
+SOURCE=..\system\TimerHeap.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\system\TimerPool.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\system\TimerQueue.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\system\TimerWheel.h
+# End Source File
 # End Group
 # Begin Group "Resource Files"
 